@@ -21,6 +21,16 @@
     init() {
       CosmoScout.gui.initSlider("userStudy.setRecordingInterval", 1, 20, 1, [5]);
     }
+
+    /**
+     * Shows the number of checkpoints recorded so far on the recording button.
+     *
+     * @param {number} count The number of recorded checkpoints
+     */
+    setRecordedCount(count) {
+      document.querySelector('.user-study-record-button').innerHTML =
+          `<i class="material-icons">stop</i> Stop Recording (${count})`;
+    }
   }
 
   CosmoScout.init(UserStudyApi);
@@ -0,0 +1,306 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#include "CheckpointStore.hpp"
+
+#include <type_traits>
+
+namespace csp::userstudy {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StringPool::Id StringPool::intern(std::string_view value) {
+  std::size_t hash = std::hash<std::string_view>()(value);
+
+  // Check whether the string is already part of the pool.
+  auto [begin, end] = mLookup.equal_range(hash);
+  for (auto it = begin; it != end; ++it) {
+    if (get(it->second) == value) {
+      return it->second;
+    }
+  }
+
+  auto id = static_cast<Id>(mSpans.size());
+  mSpans.emplace_back(static_cast<uint32_t>(mBuffer.size()), static_cast<uint32_t>(value.size()));
+  mBuffer.append(value);
+  mLookup.emplace(hash, id);
+
+  return id;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string_view StringPool::get(Id id) const {
+  auto const& [offset, length] = mSpans[id];
+  return std::string_view(mBuffer).substr(offset, length);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t StringPool::size() const {
+  return mSpans.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t StringPool::getMemoryUsage() const {
+
+  // Each node of the hash map stores its value and a pointer to the next node.
+  std::size_t nodeSize = sizeof(std::pair<std::size_t const, Id>) + sizeof(void*);
+
+  return mBuffer.capacity() + mSpans.capacity() * sizeof(std::pair<uint32_t, uint32_t>) +
+         mLookup.bucket_count() * sizeof(void*) + mLookup.size() * nodeSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StringPool::clear() {
+  mBuffer.clear();
+  mSpans.clear();
+  mLookup.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t CheckpointStore::size() const {
+  return mTypes.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CheckpointStore::empty() const {
+  return mTypes.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CheckpointStore::clear() {
+  mTypes.clear();
+  mScalings.clear();
+  mPoses.clear();
+  mBookmarkNames.clear();
+  mData.clear();
+
+  mPoseCenters.clear();
+  mPoseFrames.clear();
+  mPosePositions.clear();
+  mPoseRotations.clear();
+  mPoseFlags.clear();
+
+  mStrings.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t CheckpointStore::getMemoryUsage() const {
+  auto bytes = [](auto const& vector) {
+    return vector.capacity() * sizeof(typename std::decay_t<decltype(vector)>::value_type);
+  };
+
+  return bytes(mTypes) + bytes(mScalings) + bytes(mPoses) + bytes(mBookmarkNames) + bytes(mData) +
+         bytes(mPoseCenters) + bytes(mPoseFrames) + bytes(mPosePositions) +
+         bytes(mPoseRotations) + bytes(mPoseFlags) + mStrings.getMemoryUsage();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CheckpointStore::reserve(std::size_t count) {
+  mTypes.reserve(count);
+  mScalings.reserve(count);
+  mPoses.reserve(count);
+  mBookmarkNames.reserve(count);
+  mData.reserve(count);
+
+  mPoseCenters.reserve(count);
+  mPoseFrames.reserve(count);
+  mPosePositions.reserve(count);
+  mPoseRotations.reserve(count);
+  mPoseFlags.reserve(count);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CheckpointStore::push_back(Checkpoint const& checkpoint) {
+  mTypes.push_back(checkpoint.mType);
+  mScalings.push_back(checkpoint.mScaling);
+  mPoses.push_back(NO_POSE);
+  mBookmarkNames.push_back(NO_STRING);
+  mData.push_back(NO_STRING);
+
+  set(mTypes.size() - 1, checkpoint);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CheckpointStore::set(std::size_t index, Checkpoint const& checkpoint) {
+  mTypes[index]         = checkpoint.mType;
+  mScalings[index]      = checkpoint.mScaling;
+  mBookmarkNames[index] = internOptional(checkpoint.mBookmarkName);
+  mData[index]          = internOptional(checkpoint.mData);
+
+  // Checkpoints without an inline location keep their pose handle so that it can be reused if
+  // they get a location again later.
+  if (checkpoint.mLocation) {
+    if (mPoses[index] == NO_POSE) {
+      mPoses[index] = static_cast<uint32_t>(mPoseFlags.size());
+      mPoseCenters.emplace_back();
+      mPoseFrames.emplace_back();
+      mPosePositions.emplace_back();
+      mPoseRotations.emplace_back();
+      mPoseFlags.emplace_back();
+    }
+
+    setPose(mPoses[index], checkpoint.mLocation.value());
+
+  } else if (mPoses[index] != NO_POSE) {
+    mPoseFlags[mPoses[index]]   = 0;
+    mPoseCenters[mPoses[index]] = NO_STRING;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CheckpointStore::resize(std::size_t count) {
+  if (count >= size()) {
+    return;
+  }
+
+  mTypes.resize(count);
+  mScalings.resize(count);
+  mPoses.resize(count);
+  mBookmarkNames.resize(count);
+  mData.resize(count);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CheckpointStore::isEqual(
+    std::size_t index, CheckpointStore const& other, std::size_t otherIndex) const {
+
+  if (mTypes[index] != other.mTypes[otherIndex] ||
+      mScalings[index] != other.mScalings[otherIndex] ||
+      getBookmarkName(index) != other.getBookmarkName(otherIndex) ||
+      getData(index) != other.getData(otherIndex)) {
+    return false;
+  }
+
+  uint32_t pose      = mPoses[index];
+  uint32_t otherPose = other.mPoses[otherIndex];
+
+  bool hasPose      = pose != NO_POSE && mPoseCenters[pose] != NO_STRING;
+  bool otherHasPose = otherPose != NO_POSE && other.mPoseCenters[otherPose] != NO_STRING;
+
+  if (!hasPose || !otherHasPose) {
+    return hasPose == otherHasPose;
+  }
+
+  return mPoseFlags[pose] == other.mPoseFlags[otherPose] &&
+         mPosePositions[pose] == other.mPosePositions[otherPose] &&
+         mPoseRotations[pose] == other.mPoseRotations[otherPose] &&
+         mStrings.get(mPoseCenters[pose]) == other.mStrings.get(other.mPoseCenters[otherPose]) &&
+         mStrings.get(mPoseFrames[pose]) == other.mStrings.get(other.mPoseFrames[otherPose]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Checkpoint CheckpointStore::get(std::size_t index) const {
+  Checkpoint checkpoint;
+  checkpoint.mType     = mTypes[index];
+  checkpoint.mScaling  = mScalings[index];
+  checkpoint.mLocation = getLocation(index);
+
+  if (auto name = getBookmarkName(index)) {
+    checkpoint.mBookmarkName = std::string(*name);
+  }
+
+  if (auto data = getData(index)) {
+    checkpoint.mData = std::string(*data);
+  }
+
+  return checkpoint;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Checkpoint::Type CheckpointStore::getType(std::size_t index) const {
+  return mTypes[index];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float CheckpointStore::getScaling(std::size_t index) const {
+  return mScalings[index];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<std::string_view> CheckpointStore::getBookmarkName(std::size_t index) const {
+  if (mBookmarkNames[index] == NO_STRING) {
+    return std::nullopt;
+  }
+
+  return mStrings.get(mBookmarkNames[index]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<std::string_view> CheckpointStore::getData(std::size_t index) const {
+  if (mData[index] == NO_STRING) {
+    return std::nullopt;
+  }
+
+  return mStrings.get(mData[index]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<cs::core::Settings::Bookmark::Location> CheckpointStore::getLocation(
+    std::size_t index) const {
+
+  uint32_t pose = mPoses[index];
+
+  if (pose == NO_POSE || mPoseCenters[pose] == NO_STRING) {
+    return std::nullopt;
+  }
+
+  cs::core::Settings::Bookmark::Location location;
+  location.mCenter = mStrings.get(mPoseCenters[pose]);
+  location.mFrame  = mStrings.get(mPoseFrames[pose]);
+
+  if (mPoseFlags[pose] & HAS_POSITION) {
+    location.mPosition = mPosePositions[pose];
+  }
+
+  if (mPoseFlags[pose] & HAS_ROTATION) {
+    location.mRotation = mPoseRotations[pose];
+  }
+
+  return location;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StringPool::Id CheckpointStore::internOptional(std::optional<std::string> const& value) {
+  return value ? mStrings.intern(value.value()) : NO_STRING;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CheckpointStore::setPose(
+    uint32_t pose, cs::core::Settings::Bookmark::Location const& location) {
+
+  mPoseCenters[pose]   = mStrings.intern(location.mCenter);
+  mPoseFrames[pose]    = mStrings.intern(location.mFrame);
+  mPosePositions[pose] = location.mPosition.value_or(glm::dvec3(0.0, 0.0, 0.0));
+  mPoseRotations[pose] = location.mRotation.value_or(glm::dquat(1.0, 0.0, 0.0, 0.0));
+  mPoseFlags[pose]     = static_cast<uint8_t>((location.mPosition ? HAS_POSITION : 0U) |
+                                          (location.mRotation ? HAS_ROTATION : 0U));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::userstudy
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#ifndef CSP_USER_STUDY_CHECKPOINT_STORE_HPP
+#define CSP_USER_STUDY_CHECKPOINT_STORE_HPP
+
+#include "../../../src/cs-core/Settings.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace csp::userstudy {
+
+/// The settings for a stage of the scenario. This is the representation used in the JSON settings.
+/// In memory, all checkpoints of a scenario are kept in a CheckpointStore.
+struct Checkpoint {
+  enum class Type { eSimple, eRequestFMS, eRequestCOG, eMessage, eSwitchScenario };
+
+  /// The type of the stage
+  Type mType{Type::eSimple};
+
+  /// The related bookmark for the position & orientation. This is only used if no inline
+  /// location is given. It is kept for scenarios which have been recorded with older versions.
+  std::optional<std::string> mBookmarkName;
+
+  /// The position & orientation of the checkpoint. If this is set, no bookmark is required.
+  std::optional<cs::core::Settings::Bookmark::Location> mLocation;
+
+  /// The scaling factor for the stage mark
+  float mScaling = 1.F;
+
+  /// For now, this is only used for the message of eMessage checkpoints.
+  std::optional<std::string> mData;
+};
+
+/// Stores strings in one contiguous buffer. Each distinct string is stored only once and is
+/// referenced by an ID. Strings are never removed individually; the whole pool can be cleared.
+class StringPool {
+ public:
+  using Id = uint32_t;
+
+  /// Returns the ID of the given string. If the string is not yet part of the pool, it is added.
+  Id intern(std::string_view value);
+
+  /// Returns the string with the given ID. The returned view is invalidated by the next call to
+  /// intern() or clear().
+  std::string_view get(Id id) const;
+
+  /// Returns the number of distinct strings in the pool.
+  std::size_t size() const;
+
+  /// Returns the number of bytes allocated by the pool. The size of the hash map's nodes is
+  /// estimated.
+  std::size_t getMemoryUsage() const;
+
+  void clear();
+
+ private:
+  std::string                                mBuffer;
+  std::vector<std::pair<uint32_t, uint32_t>> mSpans;
+  std::unordered_multimap<std::size_t, Id>   mLookup;
+};
+
+/// Stores the checkpoints of a scenario in a structure-of-arrays layout. All strings are interned
+/// in a StringPool, so the many repeated bookmark names, frame names and messages of large
+/// scenarios do not require individual heap allocations. Inline locations are referenced by a
+/// pose handle, checkpoints referencing a bookmark do not have a pose.
+class CheckpointStore {
+ public:
+  std::size_t size() const;
+  bool        empty() const;
+  void        clear();
+  void        reserve(std::size_t count);
+
+  /// Returns the number of bytes allocated by the store, including its StringPool.
+  std::size_t getMemoryUsage() const;
+
+  /// Appends a new checkpoint at the end.
+  void push_back(Checkpoint const& checkpoint);
+
+  /// Replaces the checkpoint at the given index. Strings which are no longer referenced stay in
+  /// the pool until the store is cleared.
+  void set(std::size_t index, Checkpoint const& checkpoint);
+
+  /// Removes all checkpoints after the given count. Their poses and strings stay allocated until
+  /// the store is cleared.
+  void resize(std::size_t count);
+
+  /// Returns true if the checkpoint at the given index is equal to the checkpoint at otherIndex in
+  /// the other store.
+  bool isEqual(std::size_t index, CheckpointStore const& other, std::size_t otherIndex) const;
+
+  /// Assembles the checkpoint at the given index. This is mainly used for serialization, use the
+  /// accessors below in performance-critical code.
+  Checkpoint get(std::size_t index) const;
+
+  Checkpoint::Type                                      getType(std::size_t index) const;
+  float                                                 getScaling(std::size_t index) const;
+  std::optional<std::string_view>                       getBookmarkName(std::size_t index) const;
+  std::optional<std::string_view>                       getData(std::size_t index) const;
+  std::optional<cs::core::Settings::Bookmark::Location> getLocation(std::size_t index) const;
+
+ private:
+  static constexpr StringPool::Id NO_STRING = ~0U;
+  static constexpr uint32_t       NO_POSE   = ~0U;
+
+  static constexpr uint8_t HAS_POSITION = 1U;
+  static constexpr uint8_t HAS_ROTATION = 2U;
+
+  StringPool::Id internOptional(std::optional<std::string> const& value);
+  void           setPose(uint32_t pose, cs::core::Settings::Bookmark::Location const& location);
+
+  // One entry per checkpoint.
+  std::vector<Checkpoint::Type> mTypes;
+  std::vector<float>            mScalings;
+  std::vector<uint32_t>         mPoses;
+  std::vector<StringPool::Id>   mBookmarkNames;
+  std::vector<StringPool::Id>   mData;
+
+  // One entry per inline location.
+  std::vector<StringPool::Id> mPoseCenters;
+  std::vector<StringPool::Id> mPoseFrames;
+  std::vector<glm::dvec3>     mPosePositions;
+  std::vector<glm::dquat>     mPoseRotations;
+  std::vector<uint8_t>        mPoseFlags;
+
+  StringPool mStrings;
+};
+
+} // namespace csp::userstudy
+
+#endif // CSP_USER_STUDY_CHECKPOINT_STORE_HPP
@@ -0,0 +1,47 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#include "FrameTimeStatistics.hpp"
+
+#include <algorithm>
+
+namespace csp::userstudy {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameTimeStatistics computeFrameTimeStatistics(std::vector<float>& frameTimes, float budget) {
+  FrameTimeStatistics statistics;
+  statistics.mFrameCount = frameTimes.size();
+
+  if (frameTimes.empty()) {
+    return statistics;
+  }
+
+  // Returns the given percentile with the nearest-rank method, so the returned frame time is one
+  // of the measured ones and at least the given fraction of frames is not longer. Each call only
+  // partially sorts the frame times. The rank is computed with integers, as a rounding error in
+  // p * n could otherwise skip a rank.
+  auto percentile = [&frameTimes](std::size_t percent) {
+    std::size_t rank  = (percent * frameTimes.size() + 99) / 100;
+    std::size_t index = std::max<std::size_t>(rank, 1) - 1;
+    std::nth_element(frameTimes.begin(), frameTimes.begin() + index, frameTimes.end());
+    return frameTimes[index];
+  };
+
+  statistics.mMedian = percentile(50);
+  statistics.mP95    = percentile(95);
+  statistics.mP99    = percentile(99);
+  statistics.mMax    = *std::max_element(frameTimes.begin(), frameTimes.end());
+  statistics.mOverBudget = static_cast<std::size_t>(std::count_if(
+      frameTimes.begin(), frameTimes.end(), [budget](float t) { return t > budget; }));
+
+  return statistics;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::userstudy
@@ -0,0 +1,36 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#ifndef CSP_USER_STUDY_FRAME_TIME_STATISTICS_HPP
+#define CSP_USER_STUDY_FRAME_TIME_STATISTICS_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace csp::userstudy {
+
+/// Stutter metrics of a sequence of frames.
+struct FrameTimeStatistics {
+  std::size_t mFrameCount = 0;
+
+  /// Nearest-rank percentiles and maximum of the frame times in milliseconds. The maximum is the
+  /// longest hitch.
+  float mMedian = 0.F;
+  float mP95    = 0.F;
+  float mP99    = 0.F;
+  float mMax    = 0.F;
+
+  /// The number of frames which took longer than the frame-time budget.
+  std::size_t mOverBudget = 0;
+};
+
+/// Computes the statistics of the given frame times. The frame times are reordered in the process.
+FrameTimeStatistics computeFrameTimeStatistics(std::vector<float>& frameTimes, float budget);
+
+} // namespace csp::userstudy
+
+#endif // CSP_USER_STUDY_FRAME_TIME_STATISTICS_HPP
@@ -9,9 +9,12 @@
 #include "../../../src/cs-core/GuiManager.hpp"
 #include "../../../src/cs-core/InputManager.hpp"
 #include "../../../src/cs-core/SolarSystem.hpp"
+#include "../../../src/cs-core/TimeControl.hpp"
 #include "../../../src/cs-scene/CelestialAnchor.hpp"
 #include "logger.hpp"
+#include "ScenarioWatcher.hpp"
 #include "resultsLogger.hpp"
+#include "scenarioGenerator.hpp"
 
 #include <VistaKernel/GraphicsManager/VistaOpenGLNode.h>
 #include <VistaKernel/GraphicsManager/VistaSceneGraph.h>
@@ -20,7 +23,10 @@
 #include <VistaKernelOpenSGExt/VistaOpenSGMaterialTools.h>
 
 #include <glm/gtc/type_ptr.hpp>
+#include <fstream>
 #include <optional>
+#include <set>
+#include <unordered_map>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -58,6 +64,7 @@ NLOHMANN_JSON_SERIALIZE_ENUM(Plugin::Settings::Checkpoint::Type, {
 void from_json(nlohmann::json const& j, Plugin::Settings::Checkpoint& o) {
   cs::core::Settings::deserialize(j, "type", o.mType);
   cs::core::Settings::deserialize(j, "bookmark", o.mBookmarkName);
+  cs::core::Settings::deserialize(j, "location", o.mLocation);
   cs::core::Settings::deserialize(j, "scale", o.mScaling);
   cs::core::Settings::deserialize(j, "data", o.mData);
 }
@@ -65,6 +72,7 @@ void from_json(nlohmann::json const& j, Plugin::Settings::Checkpoint& o) {
 void to_json(nlohmann::json& j, Plugin::Settings::Checkpoint const& o) {
   cs::core::Settings::serialize(j, "type", o.mType);
   cs::core::Settings::serialize(j, "bookmark", o.mBookmarkName);
+  cs::core::Settings::serialize(j, "location", o.mLocation);
   cs::core::Settings::serialize(j, "scale", o.mScaling);
   cs::core::Settings::serialize(j, "data", o.mData);
 }
@@ -79,26 +87,76 @@ void to_json(nlohmann::json& j, Plugin::Settings::Scenario const& o) {
   cs::core::Settings::serialize(j, "path", o.mPath);
 }
 
+// The CheckpointStore is stored as a plain array of checkpoints.
+void from_json(nlohmann::json const& j, CheckpointStore& o) {
+  o.clear();
+  o.reserve(j.size());
+
+  for (auto const& checkpoint : j) {
+    o.push_back(checkpoint.get<Checkpoint>());
+  }
+}
+
+void to_json(nlohmann::json& j, CheckpointStore const& o) {
+  j = nlohmann::json::array();
+
+  for (std::size_t i = 0; i < o.size(); ++i) {
+    j.push_back(o.get(i));
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void from_json(nlohmann::json const& j, Plugin::Settings& o) {
   cs::core::Settings::deserialize(j, "otherScenarios", o.mOtherScenarios);
   cs::core::Settings::deserialize(j, "recordingInterval", o.pRecordingInterval);
+  cs::core::Settings::deserialize(j, "enableTrajectoryLogging", o.pEnableTrajectoryLogging);
+  cs::core::Settings::deserialize(
+      j, "trajectoryPositionPrecision", o.pTrajectoryPositionPrecision);
+  cs::core::Settings::deserialize(j, "trajectoryRotationBits", o.pTrajectoryRotationBits);
+  cs::core::Settings::deserialize(j, "trajectoryScaleBits", o.pTrajectoryScaleBits);
+  cs::core::Settings::deserialize(j, "frameTimeBudget", o.pFrameTimeBudget);
+  cs::core::Settings::deserialize(j, "enableAutoResync", o.pEnableAutoResync);
+  cs::core::Settings::deserialize(j, "resyncWindow", o.pResyncWindow);
   cs::core::Settings::deserialize(j, "checkpoints", o.mCheckpoints);
 }
 
 void to_json(nlohmann::json& j, Plugin::Settings const& o) {
   cs::core::Settings::serialize(j, "otherScenarios", o.mOtherScenarios);
   cs::core::Settings::serialize(j, "recordingInterval", o.pRecordingInterval);
+  cs::core::Settings::serialize(j, "enableTrajectoryLogging", o.pEnableTrajectoryLogging);
+  cs::core::Settings::serialize(j, "trajectoryPositionPrecision", o.pTrajectoryPositionPrecision);
+  cs::core::Settings::serialize(j, "trajectoryRotationBits", o.pTrajectoryRotationBits);
+  cs::core::Settings::serialize(j, "trajectoryScaleBits", o.pTrajectoryScaleBits);
+  cs::core::Settings::serialize(j, "frameTimeBudget", o.pFrameTimeBudget);
+  cs::core::Settings::serialize(j, "enableAutoResync", o.pEnableAutoResync);
+  cs::core::Settings::serialize(j, "resyncWindow", o.pResyncWindow);
   cs::core::Settings::serialize(j, "checkpoints", o.mCheckpoints);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+bool Plugin::TransformInputs::operator==(TransformInputs const& other) const {
+  return mPosition == other.mPosition && mRotation == other.mRotation && mScale == other.mScale &&
+         mSimulationTime == other.mSimulationTime && mCenter == other.mCenter &&
+         mFrame == other.mFrame;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double Plugin::Statistics::getSkipRatio() const {
+  std::size_t total = mTransformUpdates + mTransformSkips;
+  return total > 0 ? static_cast<double>(mTransformSkips) / static_cast<double>(total) : 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void Plugin::init() {
 
   logger().info("Loading plugin ...");
 
+  mSegmentFrameTimes.reserve(FRAME_TIME_CAPACITY);
+
   // Deserialize and serialize the plugin's settings when the scene settings are loaded and saved.
   mOnLoadConnection = mAllSettings->onLoad().connect([this]() { onLoad(); });
   mOnSaveConnection = mAllSettings->onSave().connect(
@@ -124,12 +182,11 @@ void Plugin::init() {
 
         if (enable) {
 
-          // Update the label of the HTML button.
-          mGuiManager->getGui()->executeJavascript(
-              "document.querySelector('.user-study-record-button').innerHTML = "
-              "'<i class=\"material-icons\">stop</i> Stop Recording';");
+          // Update the label of the HTML button. It will show the number of recorded checkpoints.
+          mGuiManager->getGui()->callJavascript("CosmoScout.userStudy.setRecordedCount", 0);
 
-          // Remove all checkpoints and all corresponding bookmarks.
+          // Remove all checkpoints and all bookmarks which have been created by recordings of
+          // previous versions of this plugin.
           mPluginSettings->mCheckpoints.clear();
           mCurrentCheckpointIdx = 0;
 
@@ -148,6 +205,11 @@ void Plugin::init() {
             }
           } while (bookmarksFound);
 
+          // The recorded poses are only kept in memory until the recording is stopped. We reserve
+          // some space up-front so that no reallocations happen during typical recordings.
+          mRecordedPoses.clear();
+          mRecordedPoses.reserve(RECORDING_CAPACITY);
+
           // This is used to check when a new checkpoint needs to be recorded.
           mLastRecordTime = std::chrono::steady_clock::now();
 
@@ -158,6 +220,9 @@ void Plugin::init() {
               "document.querySelector('.user-study-record-button').innerHTML = "
               "'<i class=\"material-icons\">fiber_manual_record</i> Start New Recording';");
 
+          // Now create all bookmarks and checkpoints which have been recorded.
+          commitRecording();
+
           // Show the first n checkpoints.
           for (std::size_t i = 0; i < mCheckpointViews.size(); i++) {
             prepareCheckpoint(i);
@@ -167,6 +232,35 @@ void Plugin::init() {
         updateCheckpointVisibility();
       }));
 
+  mGuiManager->getGui()->registerCallback("userStudy.loadScenario",
+      "Loads the scenario at the given path and reloads changed checkpoints whenever the file is "
+      "modified.",
+      std::function([this](std::string path) { loadScenario(path); }));
+
+  mGuiManager->getGui()->registerCallback("userStudy.migrateCheckpoints",
+      "Stores the locations of all bookmark-based checkpoints inline.",
+      std::function([this]() { migrateCheckpoints(); }));
+
+  mGuiManager->getGui()->registerCallback("userStudy.generateScenario",
+      "Writes the current scene with a synthetic scenario to the given file. The other parameters "
+      "are the number of checkpoints, the number of reference frames and the fraction of "
+      "bookmark-based checkpoints.",
+      std::function([this](std::string path, double checkpointCount, double frameCount,
+                        double bookmarkRatio) {
+        writeGeneratedScenario(path, static_cast<std::size_t>(checkpointCount),
+            static_cast<std::size_t>(frameCount), bookmarkRatio);
+      }));
+
+  mGuiManager->getGui()->registerCallback("userStudy.runBenchmark",
+      "Benchmarks synthetic scenarios with up to the given number of checkpoints.",
+      std::function([this](double maxCheckpointCount) {
+        runBenchmark(static_cast<std::size_t>(maxCheckpointCount));
+      }));
+
+  mGuiManager->getGui()->registerCallback("userStudy.analyzeTrajectory",
+      "Compares the trajectory in the given file to the checkpoints of the current scenario.",
+      std::function([this](std::string path) { analyzeTrajectory(path); }));
+
   mGuiManager->getGui()->registerCallback(
       "userStudy.gotoFirst", "Teleports to the first checkpoint.", std::function([this]() {
         while (mCurrentCheckpointIdx > 0) {
@@ -200,8 +294,7 @@ void Plugin::init() {
       return;
     }
 
-    resultsLogger().info(
-        "{}: RESET", mPluginSettings->mCheckpoints[mCurrentCheckpointIdx].mBookmarkName);
+    resultsLogger().info("{}: RESET", getCheckpointName(mCurrentCheckpointIdx));
 
     teleportToCurrent();
   });
@@ -241,6 +334,11 @@ void Plugin::deInit() {
   mGuiManager->removeSettingsSection("User Study");
   mGuiManager->getGui()->unregisterCallback("userStudy.setRecordingInterval");
   mGuiManager->getGui()->unregisterCallback("userStudy.setEnableRecording");
+  mGuiManager->getGui()->unregisterCallback("userStudy.loadScenario");
+  mGuiManager->getGui()->unregisterCallback("userStudy.migrateCheckpoints");
+  mGuiManager->getGui()->unregisterCallback("userStudy.generateScenario");
+  mGuiManager->getGui()->unregisterCallback("userStudy.runBenchmark");
+  mGuiManager->getGui()->unregisterCallback("userStudy.analyzeTrajectory");
   mGuiManager->getGui()->unregisterCallback("userStudy.gotoFirst");
   mGuiManager->getGui()->unregisterCallback("userStudy.gotoPrevious");
   mGuiManager->getGui()->unregisterCallback("userStudy.gotoNext");
@@ -249,6 +347,17 @@ void Plugin::deInit() {
   GetVistaSystem()->GetKeyboardSystemControl()->UnbindAction(VISTA_KEY_BACKSPACE);
   GetVistaSystem()->GetKeyboardSystemControl()->UnbindAction(VISTA_KEY_HOME);
 
+  mPendingScenarioWatcher.reset();
+  mScenarioWatcher.reset();
+
+  if (mBenchmarkScenario.valid()) {
+    mBenchmarkScenario.wait();
+  }
+
+  if (mTrajectoryAnalysis.valid()) {
+    mTrajectoryAnalysis.wait();
+  }
+
   logger().info("Unloading done.");
 }
 
@@ -256,13 +365,46 @@ void Plugin::deInit() {
 
 void Plugin::onLoad() {
 
+  // The frames at the current checkpoint of the previous scenario have not been logged yet. The
+  // frame which loads the new scenario is not part of them, as it is only measured in the next
+  // update().
+  if (mCurrentCheckpointIdx < mPluginSettings->mCheckpoints.size()) {
+    logFrameTimes(mCurrentCheckpointIdx);
+  }
+
   unload();
 
+  // Only watch the scenario file if this scene has been loaded with loadScenario().
+  mScenarioWatcher = std::move(mPendingScenarioWatcher);
+
   mCurrentCheckpointIdx = 0;
 
+  // Loading a scenario takes a while, this should not be counted as a long frame.
+  mSegmentFrameTimes.clear();
+  mLastFrameTime = {};
+
   // Read settings from JSON
   from_json(mAllSettings->mPlugins.at("csp-user-study"), *mPluginSettings);
 
+  rebuildSpatialIndices();
+
+  // Each loaded scenario gets its own trajectory file. Its name is written to the results log so
+  // that both can be associated later.
+  if (mPluginSettings->pEnableTrajectoryLogging.get()) {
+    std::string fileName = getSessionTimestamp() + "_userstudy_trajectory_" +
+                           std::to_string(mTrajectoryCount++) + ".bin";
+
+    TrajectoryQuantization quantization;
+    quantization.mPositionPrecision = mPluginSettings->pTrajectoryPositionPrecision.get();
+    quantization.mRotationBits      = mPluginSettings->pTrajectoryRotationBits.get();
+    quantization.mScaleBits         = mPluginSettings->pTrajectoryScaleBits.get();
+
+    mTrajectoryWriter    = std::make_unique<TrajectoryWriter>(fileName, quantization);
+    mTrajectoryStartTime = std::chrono::steady_clock::now();
+
+    resultsLogger().info("Writing trajectory to {}", fileName);
+  }
+
   // Get scenegraph to init checkpoints
   VistaSceneGraph* pSG = GetVistaSystem()->GetGraphicsManager()->GetSceneGraph();
 
@@ -299,22 +441,18 @@ void Plugin::onLoad() {
         std::function([this](double value) { mCurrentFMS = static_cast<uint32_t>(value); }));
     view.mGuiItem->registerCallback(
         "confirmFMS", "Call this to submit the FMS rating", std::function([this]() {
-          resultsLogger().info("{}: FMS: {}",
-              mPluginSettings->mCheckpoints[mCurrentCheckpointIdx].mBookmarkName,
-              mCurrentFMS.get());
+          resultsLogger().info(
+              "{}: FMS: {}", getCheckpointName(mCurrentCheckpointIdx), mCurrentFMS.get());
           nextCheckpoint();
         }));
     view.mGuiItem->registerCallback(
         "confirmMSG", "Call this to advance to the next checkpoint", std::function([this]() {
-          resultsLogger().info(
-              "{}: MSG", mPluginSettings->mCheckpoints[mCurrentCheckpointIdx].mBookmarkName);
+          resultsLogger().info("{}: MSG", getCheckpointName(mCurrentCheckpointIdx));
           nextCheckpoint();
         }));
     view.mGuiItem->registerCallback(
-        "loadScenario", "Call this to load a new scenario", std::function([this](std::string path) {
-          resultsLogger().info("Loading Scenario at " + path);
-          mGuiManager->getGui()->callJavascript("CosmoScout.callbacks.core.load", path);
-        }));
+        "loadScenario", "Call this to load a new scenario",
+        std::function([this](std::string path) { loadScenario(path); }));
     view.mGuiItem->registerCallback("setEnableCOGMeasurement",
         "Enables or disables center of gravity recording.", std::function([this](bool enable) {
           mEnableCOGMeasurement = enable;
@@ -333,6 +471,17 @@ void Plugin::onLoad() {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void Plugin::unload() {
+  if (mStatistics.mTransformUpdates + mStatistics.mTransformSkips > 0) {
+    logger().info("Skipped {} of {} checkpoint transformation updates ({:.1f}%).",
+        mStatistics.mTransformSkips, mStatistics.mTransformUpdates + mStatistics.mTransformSkips,
+        mStatistics.getSkipRatio() * 100.0);
+  }
+
+  mStatistics = {};
+
+  // This writes all pending samples and waits for the background thread to finish.
+  mTrajectoryWriter.reset();
+
   VistaSceneGraph* pSG = GetVistaSystem()->GetGraphicsManager()->GetSceneGraph();
   for (auto& view : mCheckpointViews) {
 
@@ -366,65 +515,121 @@ void Plugin::unload() {
 
 void Plugin::update() {
 
-  // If we are in recording-mode, we add CosmoScout bookmarks at regular intervals and store
-  // corresponding checkpoints.
+  // Record the duration of the last frame.
+  auto frameTime = std::chrono::steady_clock::now();
+
+  if (!mIsBenchmarkRunning && mLastFrameTime != std::chrono::steady_clock::time_point()) {
+    auto milliseconds =
+        std::chrono::duration<float, std::milli>(frameTime - mLastFrameTime).count();
+
+    mSegmentFrameTimes.push_back(milliseconds);
+  }
+
+  mLastFrameTime = frameTime;
+
+  // Run the next step of the benchmark if its scenario has been prepared. The benchmark calls
+  // update() itself, so this is skipped while a step is executed.
+  if (!mIsBenchmarkRunning) {
+    stepBenchmark();
+  }
+
+  // Incorporate any changes of the scenario file. While the benchmark is running, the changes are
+  // kept until the original checkpoints are restored.
+  if (mScenarioWatcher && !mIsBenchmarkRunning) {
+    auto changes = mScenarioWatcher->takeChanges();
+    if (changes) {
+      applyScenarioChanges(changes->mSettings, changes->mBookmarks);
+    }
+  }
+
+  // If we are in recording-mode, we store the observer's pose at regular intervals. The
+  // corresponding bookmarks and checkpoints are created once the recording is stopped. Adding
+  // bookmarks updates the sidebar, which would cause hitches while the operator is flying.
   if (mEnableRecording) {
     auto now = std::chrono::steady_clock::now();
     if (std::chrono::duration_cast<std::chrono::seconds>(now - mLastRecordTime).count() >=
         mPluginSettings->pRecordingInterval.get()) {
       mLastRecordTime = now;
 
-      cs::core::Settings::Bookmark bookmark;
-      bookmark.mName =
-          "user-study-bookmark-" + std::to_string(mPluginSettings->mCheckpoints.size());
-      bookmark.mLocation = {this->mSolarSystem->getObserver().getCenterName(),
-          this->mSolarSystem->getObserver().getFrameName(),
-          this->mSolarSystem->getObserver().getPosition(),
-          this->mSolarSystem->getObserver().getRotation()};
+      auto const& observer = mSolarSystem->getObserver();
 
-      mGuiManager->addBookmark(bookmark);
+      RecordedPose pose;
+      pose.mLocation = {observer.getCenterName(), observer.getFrameName(), observer.getPosition(),
+          observer.getRotation()};
+      pose.mScaling  = static_cast<float>(observer.getScale());
+      mRecordedPoses.push_back(pose);
 
-      Settings::Checkpoint checkpoint;
-      checkpoint.mScaling      = static_cast<float>(this->mSolarSystem->getObserver().getScale());
-      checkpoint.mBookmarkName = bookmark.mName;
-      mPluginSettings->mCheckpoints.push_back(checkpoint);
+      mGuiManager->getGui()->callJavascript(
+          "CosmoScout.userStudy.setRecordedCount", mRecordedPoses.size());
 
-      logger().info("Recorded Checkpoint {}.", bookmark.mName);
+      logger().info("Recorded Checkpoint {}.", mRecordedPoses.size() - 1);
     }
 
   } else {
 
     // If we are not currently recording, we update the transformation of all visible checkpoints.
     // As we are rendering relative to the eye, they all have to transformed into observer-centric
-    // coordinates.
+    // coordinates. This only depends on the observer and the simulation time, so if none of them
+    // changed since the last frame, we can keep the transformations. This is often the case, for
+    // instance while the user is giving an FMS rating.
+    auto const&     observer = mSolarSystem->getObserver();
+    TransformInputs inputs{observer.getCenterName(), observer.getFrameName(),
+        observer.getPosition(), observer.getRotation(), observer.getScale(),
+        mTimeControl->pSimulationTime.get()};
+
+    bool inputsChanged = !(inputs == mLastTransformInputs);
+    if (inputsChanged) {
+      mLastTransformInputs = std::move(inputs);
+    }
+
+    // Log the observer's pose while a scenario is running.
+    if (mTrajectoryWriter && !mIsBenchmarkRunning && !mPluginSettings->mCheckpoints.empty()) {
+      auto elapsed = std::chrono::steady_clock::now() - mTrajectoryStartTime;
+
+      TrajectorySample sample;
+      sample.mTime       = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+      sample.mCheckpoint = static_cast<uint32_t>(mCurrentCheckpointIdx);
+      sample.mPosition   = mLastTransformInputs.mPosition;
+      sample.mRotation   = mLastTransformInputs.mRotation;
+      sample.mScale      = mLastTransformInputs.mScale;
+
+      mTrajectoryWriter->push(mLastTransformInputs.mCenter, mLastTransformInputs.mFrame, sample);
+    }
+
     if (mPluginSettings->mCheckpoints.size() > 0) {
       for (size_t i = 0; i < mCheckpointViews.size(); i++) {
 
         // Loop through the stored checkpoints in the config.
         size_t checkpointIdx = (mCurrentCheckpointIdx + i) % mPluginSettings->mCheckpoints.size();
         size_t viewIdx       = (mCurrentCheckpointIdx + i) % mCheckpointViews.size();
+        auto&  view          = mCheckpointViews[viewIdx];
+
+        if (!inputsChanged && view.mTransformCheckpointIdx == checkpointIdx) {
+          ++mStatistics.mTransformSkips;
+          continue;
+        }
 
-        // Retrieve the transformation information from the corresponding bookmark.
-        glm::dvec3 positionOffset(0, 0, 0);
-        glm::dquat rotationOffset(1, 0, 0, 0);
-        float      scale = mPluginSettings->mCheckpoints[checkpointIdx].mScaling;
+        ++mStatistics.mTransformUpdates;
 
-        auto b = getBookmarkByName(mPluginSettings->mCheckpoints[checkpointIdx].mBookmarkName);
+        // Retrieve the transformation information from the checkpoint's location.
+        auto location = getCheckpointLocation(checkpointIdx);
 
-        if (b->mLocation.has_value()) {
-          if (b->mLocation->mPosition.has_value())
-            positionOffset = b->mLocation->mPosition.value();
-          if (b->mLocation->mRotation.has_value())
-            rotationOffset = b->mLocation->mRotation.value();
+        if (!location) {
+          continue;
         }
 
+        glm::dvec3 positionOffset = location->mPosition.value_or(glm::dvec3(0.0, 0.0, 0.0));
+        glm::dquat rotationOffset = location->mRotation.value_or(glm::dquat(1.0, 0.0, 0.0, 0.0));
+        float      scale          = mPluginSettings->mCheckpoints.getScaling(checkpointIdx);
+
         // Get the observer-relative transformation and apply it to the checkpoint.
-        auto object = getObjectForBookmark(*b);
+        auto object = getObjectForLocation(*location);
 
         if (object) {
           auto transform =
               object->getObserverRelativeTransform(positionOffset, rotationOffset, scale);
-          mCheckpointViews[viewIdx].mTransformNode->SetTransform(glm::value_ptr(transform), true);
+          view.mTransformNode->SetTransform(glm::value_ptr(transform), true);
+          view.mTransformCheckpointIdx = checkpointIdx;
         }
       }
     }
@@ -432,26 +637,22 @@ void Plugin::update() {
     // Check if we are close to the current checkpoint. If it is "Simple" checkpoint which the user
     // only needs to pass through, we advance to the next checkpoint.
     if (mCurrentCheckpointIdx < mPluginSettings->mCheckpoints.size()) {
-      auto checkpoint = mPluginSettings->mCheckpoints[mCurrentCheckpointIdx];
-
-      if (checkpoint.mType == Plugin::Settings::Checkpoint::Type::eSimple) {
+      auto type = mPluginSettings->mCheckpoints.getType(mCurrentCheckpointIdx);
 
-        auto b = getBookmarkByName(checkpoint.mBookmarkName);
+      if (type == Plugin::Settings::Checkpoint::Type::eSimple) {
 
-        glm::dvec3 positionOffset(0, 0, 0);
-        if (b->mLocation.has_value()) {
-          if (b->mLocation->mPosition.has_value())
-            positionOffset = b->mLocation->mPosition.value();
-        }
-
-        auto object = getObjectForBookmark(*b);
+        auto location = getCheckpointLocation(mCurrentCheckpointIdx);
+        auto object   = location ? getObjectForLocation(*location) : nullptr;
 
         if (object) {
-          glm::dvec3 vecToObserver = object->getObserverRelativePosition(positionOffset);
+          glm::dvec3 positionOffset = location->mPosition.value_or(glm::dvec3(0.0, 0.0, 0.0));
+          glm::dvec3 vecToObserver  = object->getObserverRelativePosition(positionOffset);
 
           if (glm::length(vecToObserver) < 1.0) {
-            logger().info("{}: Passed Checkpoint", checkpoint.mBookmarkName);
+            logger().info("{}: Passed Checkpoint", getCheckpointName(mCurrentCheckpointIdx));
             nextCheckpoint();
+          } else if (inputsChanged && mPluginSettings->pEnableAutoResync.get()) {
+            resyncToNearest(*location, *object);
           }
         }
       }
@@ -461,17 +662,44 @@ void Plugin::update() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void Plugin::commitRecording() {
+  if (mRecordedPoses.empty()) {
+    return;
+  }
+
+  auto& checkpoints = mPluginSettings->mCheckpoints;
+  checkpoints.reserve(checkpoints.size() + mRecordedPoses.size());
+
+  for (auto const& pose : mRecordedPoses) {
+    Settings::Checkpoint checkpoint;
+    checkpoint.mScaling  = pose.mScaling;
+    checkpoint.mLocation = pose.mLocation;
+    checkpoints.push_back(checkpoint);
+  }
+
+  logger().info("Committed {} recorded checkpoints.", mRecordedPoses.size());
+
+  rebuildSpatialIndices();
+
+  mRecordedPoses.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void Plugin::prepareCheckpoint(std::size_t index) {
   if (index >= mPluginSettings->mCheckpoints.size()) {
     return;
   }
 
   // Get the settings and view for the new checkpoint.
-  auto const& settings = mPluginSettings->mCheckpoints[index];
-  auto&       view     = mCheckpointViews[(index) % mCheckpointViews.size()];
+  auto const& checkpoints = mPluginSettings->mCheckpoints;
+  auto&       view        = mCheckpointViews[(index) % mCheckpointViews.size()];
+
+  // Make sure that the transformation is recomputed in the next frame.
+  view.mTransformCheckpointIdx.reset();
 
   // Update the checkpoint's webview according to the checkpoint data.
-  switch (settings.mType) {
+  switch (checkpoints.getType(index)) {
   case Settings::Checkpoint::Type::eSimple: {
     view.mGuiItem->callJavascript("reset");
     break;
@@ -485,7 +713,7 @@ void Plugin::prepareCheckpoint(std::size_t index) {
     break;
   }
   case Settings::Checkpoint::Type::eMessage: {
-    view.mGuiItem->callJavascript("setMSG", settings.mData.value_or(""));
+    view.mGuiItem->callJavascript("setMSG", std::string(checkpoints.getData(index).value_or("")));
     break;
   }
   case Settings::Checkpoint::Type::eSwitchScenario: {
@@ -540,25 +768,18 @@ void Plugin::teleportToCurrent() {
     return;
   }
 
-  // Retrieve the bookmark for the target checkpoint.
-  auto const& settings = mPluginSettings->mCheckpoints[index];
-  auto        bookmark = getBookmarkByName(settings.mBookmarkName);
+  // Move the observer to the checkpoint's location.
+  auto location = getCheckpointLocation(index);
 
-  if (bookmark.has_value()) {
-    cs::core::Settings::Bookmark b = bookmark.value();
-
-    // Move the observer to the bookmark's position.
-    if (b.mLocation) {
-      auto loc = b.mLocation.value();
-
-      if (loc.mRotation.has_value() && loc.mPosition.has_value()) {
-        mSolarSystem->flyObserverTo(
-            loc.mCenter, loc.mFrame, loc.mPosition.value(), loc.mRotation.value(), 0.0);
-      } else if (loc.mPosition.has_value()) {
-        mSolarSystem->flyObserverTo(loc.mCenter, loc.mFrame, loc.mPosition.value(), 0.0);
-      } else {
-        mSolarSystem->flyObserverTo(loc.mCenter, loc.mFrame, 0.0);
-      }
+  if (location) {
+    if (location->mRotation.has_value() && location->mPosition.has_value()) {
+      mSolarSystem->flyObserverTo(location->mCenter, location->mFrame, location->mPosition.value(),
+          location->mRotation.value(), 0.0);
+    } else if (location->mPosition.has_value()) {
+      mSolarSystem->flyObserverTo(
+          location->mCenter, location->mFrame, location->mPosition.value(), 0.0);
+    } else {
+      mSolarSystem->flyObserverTo(location->mCenter, location->mFrame, 0.0);
     }
   }
 }
@@ -570,6 +791,8 @@ void Plugin::nextCheckpoint() {
     return;
   }
 
+  logFrameTimes(mCurrentCheckpointIdx);
+
   // Advance the current checkpoint index.
   mCurrentCheckpointIdx =
       std::min(mCurrentCheckpointIdx + 1, mPluginSettings->mCheckpoints.size() - 1);
@@ -586,6 +809,97 @@ void Plugin::nextCheckpoint() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void Plugin::rebuildSpatialIndices() {
+  mSpatialIndices.clear();
+
+  for (std::size_t i = 0; i < mPluginSettings->mCheckpoints.size(); ++i) {
+    auto location = getCheckpointLocation(i);
+    if (location && location->mPosition) {
+      mSpatialIndices[{location->mCenter, location->mFrame}].add(
+          location->mPosition.value(), static_cast<uint32_t>(i));
+    }
+  }
+
+  for (auto& [frame, index] : mSpatialIndices) {
+    index.build();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::resyncToNearest(cs::core::Settings::Bookmark::Location const& location,
+    cs::scene::CelestialObject const& object) {
+
+  auto index = mSpatialIndices.find({location.mCenter, location.mFrame});
+  if (index == mSpatialIndices.end()) {
+    return;
+  }
+
+  // Compute the observer's position in the reference frame of the current checkpoint.
+  glm::dmat4 transform =
+      object.getObserverRelativeTransform(glm::dvec3(0.0), glm::dquat(1.0, 0.0, 0.0, 0.0), 1.0);
+  glm::dvec3 observer(glm::inverse(transform) * glm::dvec4(0.0, 0.0, 0.0, 1.0));
+
+  // Only the next few checkpoints are considered. If the path passes the same place several
+  // times, a later lap may be closer than the current checkpoint. The index may refer to removed
+  // checkpoints if it has not been rebuilt yet.
+  auto first   = static_cast<uint32_t>(mCurrentCheckpointIdx + 1);
+  auto last    = static_cast<uint32_t>(std::min<std::size_t>(
+      mCurrentCheckpointIdx + mPluginSettings->pResyncWindow.get(),
+      mPluginSettings->mCheckpoints.size() - 1));
+  auto nearest = index->second.nearest(observer, first, last);
+  if (!nearest) {
+    return;
+  }
+
+  double currentDistance = glm::distance(observer, location.mPosition.value_or(glm::dvec3(0.0)));
+  if (nearest->mDistance >= currentDistance) {
+    return;
+  }
+
+  // We only skip simple checkpoints. If there is a checkpoint requiring user input in between,
+  // this will become the current one.
+  std::size_t target = mCurrentCheckpointIdx + 1;
+  while (target < nearest->mIndex &&
+         mPluginSettings->mCheckpoints.getType(target) == Settings::Checkpoint::Type::eSimple) {
+    ++target;
+  }
+
+  resultsLogger().info(
+      "{}: RESYNC: {}", getCheckpointName(mCurrentCheckpointIdx), getCheckpointName(target));
+
+  while (mCurrentCheckpointIdx < target) {
+    nextCheckpoint();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::logFrameTimes(std::size_t index) {
+
+  // The benchmark steps through synthetic checkpoints. The frames of the participant's current
+  // segment have to be kept, so that they can be logged once the benchmark is done.
+  if (mIsBenchmarkRunning) {
+    return;
+  }
+
+  if (mSegmentFrameTimes.empty()) {
+    return;
+  }
+
+  auto statistics =
+      computeFrameTimeStatistics(mSegmentFrameTimes, mPluginSettings->pFrameTimeBudget.get());
+
+  resultsLogger().info("{}: FRAMES: {} frames, median {:.2f} ms, p95 {:.2f} ms, p99 {:.2f} ms, "
+                       "max {:.2f} ms, {} over budget",
+      getCheckpointName(index), statistics.mFrameCount, statistics.mMedian, statistics.mP95,
+      statistics.mP99, statistics.mMax, statistics.mOverBudget);
+
+  mSegmentFrameTimes.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void Plugin::previousCheckpoint() {
   if (mPluginSettings->mCheckpoints.size() == 0) {
     return;
@@ -603,7 +917,632 @@ void Plugin::previousCheckpoint() {
   updateCheckpointVisibility();
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::loadScenario(std::string const& path) {
+  resultsLogger().info("Loading Scenario at " + path);
+
+  // core.load does not report failures. If the file could not be loaded, onLoad() would not be
+  // called and the pending watcher would be activated by the next scene loaded in another way.
+  // Therefore, the file is checked here and nothing is loaded if it is not a valid scenario.
+  mPendingScenarioWatcher.reset();
+
+  try {
+    std::ifstream file(path);
+    nlohmann::json::parse(file).at("plugins").at("csp-user-study");
+  } catch (std::exception const& e) {
+    logger().error("Failed to load scenario {}: {}", path, e.what());
+    return;
+  }
+
+  mPendingScenarioWatcher = std::make_unique<ScenarioWatcher>(path);
+  mGuiManager->getGui()->callJavascript("CosmoScout.callbacks.core.load", path);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::applyScenarioChanges(
+    Settings const& settings, std::vector<cs::core::Settings::Bookmark> const& bookmarks) {
+  if (mEnableRecording) {
+    logger().warn("Ignoring changes of the scenario file while recording!");
+    return;
+  }
+
+  auto&       checkpoints = mPluginSettings->mCheckpoints;
+  auto const& changed     = settings.mCheckpoints;
+  std::size_t oldCount    = checkpoints.size();
+  std::size_t commonCount = std::min(oldCount, changed.size());
+
+  // The locations of checkpoints referencing a bookmark are resolved via the GuiManager, which
+  // does not know about changes of the file. Hence, moved bookmarks are replaced there first.
+  auto movedBookmarks = updateReferencedBookmarks(changed, bookmarks);
+
+  // Update all checkpoints which are different and append or remove checkpoints at the end.
+  // Checkpoints referencing a moved bookmark have to be prepared again as well.
+  std::vector<bool> isDirty(changed.size(), false);
+  std::size_t       dirtyCount = 0;
+
+  for (std::size_t i = 0; i < commonCount; ++i) {
+    auto bookmarkName = changed.getBookmarkName(i);
+    bool isMoved = bookmarkName && movedBookmarks.count(std::string(bookmarkName.value())) > 0;
+
+    if (!checkpoints.isEqual(i, changed, i)) {
+      checkpoints.set(i, changed.get(i));
+      isDirty[i] = true;
+      ++dirtyCount;
+    } else if (isMoved) {
+      isDirty[i] = true;
+      ++dirtyCount;
+    }
+  }
+
+  checkpoints.resize(changed.size());
+
+  for (std::size_t i = commonCount; i < changed.size(); ++i) {
+    checkpoints.push_back(changed.get(i));
+    isDirty[i] = true;
+    ++dirtyCount;
+  }
+
+  auto const& oldScenarios     = mPluginSettings->mOtherScenarios;
+  auto const& newScenarios     = settings.mOtherScenarios;
+  bool        scenariosChanged = !std::equal(oldScenarios.begin(), oldScenarios.end(),
+      newScenarios.begin(), newScenarios.end(),
+      [](auto const& a, auto const& b) { return a.mName == b.mName && a.mPath == b.mPath; });
+
+  mPluginSettings->mOtherScenarios = settings.mOtherScenarios;
+
+  // The scalar settings are simply copied. The trajectory settings are used for the trajectory
+  // file of the next loaded scenario.
+  mPluginSettings->pRecordingInterval           = settings.pRecordingInterval.get();
+  mPluginSettings->pEnableTrajectoryLogging     = settings.pEnableTrajectoryLogging.get();
+  mPluginSettings->pTrajectoryPositionPrecision = settings.pTrajectoryPositionPrecision.get();
+  mPluginSettings->pTrajectoryRotationBits      = settings.pTrajectoryRotationBits.get();
+  mPluginSettings->pTrajectoryScaleBits         = settings.pTrajectoryScaleBits.get();
+  mPluginSettings->pFrameTimeBudget             = settings.pFrameTimeBudget.get();
+  mPluginSettings->pEnableAutoResync            = settings.pEnableAutoResync.get();
+  mPluginSettings->pResyncWindow                = settings.pResyncWindow.get();
+
+  if (dirtyCount == 0 && oldCount == changed.size() && !scenariosChanged) {
+    return;
+  }
+
+  // Keep the current checkpoint, unless it has been removed. In this case, all views show a
+  // different checkpoint than before.
+  bool indexChanged = false;
+
+  if (mCurrentCheckpointIdx >= checkpoints.size()) {
+    mCurrentCheckpointIdx = checkpoints.empty() ? 0 : checkpoints.size() - 1;
+    indexChanged          = true;
+  }
+
+  // Only the visible checkpoints which actually changed need to be prepared again.
+  for (std::size_t i = 0; i < mCheckpointViews.size(); i++) {
+    std::size_t index = mCurrentCheckpointIdx + i;
+    if (index >= checkpoints.size()) {
+      break;
+    }
+
+    bool showsScenarios = checkpoints.getType(index) == Settings::Checkpoint::Type::eSwitchScenario;
+    if (indexChanged || isDirty[index] || (scenariosChanged && showsScenarios)) {
+      prepareCheckpoint(index);
+    }
+  }
+
+  if (indexChanged || oldCount != checkpoints.size()) {
+    updateCheckpointVisibility();
+  }
+
+  // Removed checkpoints have to be removed from the spatial index as well.
+  if (dirtyCount > 0 || oldCount != checkpoints.size()) {
+    rebuildSpatialIndices();
+  }
+
+  logger().info("Reloaded scenario: {} of {} checkpoints changed.", dirtyCount, checkpoints.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::set<std::string> Plugin::updateReferencedBookmarks(CheckpointStore const& checkpoints,
+    std::vector<cs::core::Settings::Bookmark> const& bookmarks) {
+
+  std::set<std::string> referencedBookmarks;
+  for (std::size_t i = 0; i < checkpoints.size(); ++i) {
+    auto bookmarkName = checkpoints.getBookmarkName(i);
+    if (bookmarkName) {
+      referencedBookmarks.emplace(bookmarkName.value());
+    }
+  }
+
+  std::set<std::string> movedBookmarks;
+
+  for (auto const& bookmark : bookmarks) {
+    if (!bookmark.mLocation || referencedBookmarks.count(bookmark.mName) == 0) {
+      continue;
+    }
+
+    auto const& location = bookmark.mLocation.value();
+
+    std::optional<uint32_t> existingID;
+    bool                    isMoved = true;
+
+    for (auto const& [id, existing] : mGuiManager->getBookmarks()) {
+      if (existing.mName != bookmark.mName) {
+        continue;
+      }
+
+      existingID = id;
+
+      if (existing.mLocation) {
+        auto const& old = existing.mLocation.value();
+        isMoved = old.mCenter != location.mCenter || old.mFrame != location.mFrame ||
+                  old.mPosition != location.mPosition || old.mRotation != location.mRotation;
+      }
+
+      break;
+    }
+
+    if (!isMoved) {
+      continue;
+    }
+
+    if (existingID) {
+      mGuiManager->removeBookmark(existingID.value());
+    }
+
+    logger().info("Updating location of bookmark {}.", bookmark.mName);
+    mGuiManager->addBookmark(bookmark);
+    movedBookmarks.insert(bookmark.mName);
+  }
+
+  return movedBookmarks;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::writeGeneratedScenario(std::string const& path, std::size_t checkpointCount,
+    std::size_t frameCount, double bookmarkRatio) const {
+
+  ScenarioGeneratorOptions options;
+  options.mCheckpointCount = checkpointCount;
+  options.mFrames          = getFrames(frameCount);
+  options.mBookmarkRatio   = bookmarkRatio;
+
+  Settings                                  settings;
+  std::vector<cs::core::Settings::Bookmark> bookmarks;
+  settings.mOtherScenarios = mPluginSettings->mOtherScenarios;
+  generateScenario(options, settings, bookmarks);
+
+  // We store the generated scenario together with the current scene so that it can be loaded
+  // directly.
+  nlohmann::json scene               = *mAllSettings;
+  scene["plugins"]["csp-user-study"] = settings;
+
+  // Generated bookmarks replace existing bookmarks of the same name, so that writing several
+  // scenarios to the same scene does not create duplicates.
+  auto& sceneBookmarks = scene["bookmarks"];
+
+  if (!sceneBookmarks.is_array()) {
+    sceneBookmarks = nlohmann::json::array();
+  }
+
+  std::unordered_map<std::string, std::size_t> bookmarkIndices;
+  for (std::size_t i = 0; i < sceneBookmarks.size(); ++i) {
+    bookmarkIndices[sceneBookmarks[i].value("name", "")] = i;
+  }
+
+  for (auto const& bookmark : bookmarks) {
+    auto existing = bookmarkIndices.find(bookmark.mName);
+
+    if (existing != bookmarkIndices.end()) {
+      sceneBookmarks[existing->second] = bookmark;
+    } else {
+      bookmarkIndices[bookmark.mName] = sceneBookmarks.size();
+      sceneBookmarks.push_back(bookmark);
+    }
+  }
+
+  std::ofstream file(path);
+  file << scene.dump(2);
+
+  logger().info("Wrote a scenario with {} checkpoints to {}.", checkpointCount, path);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::runBenchmark(std::size_t maxCheckpointCount) {
+  if (mEnableRecording) {
+    logger().warn("Cannot run the benchmark while recording!");
+    return;
+  }
+
+  if (mBenchmarkScenario.valid()) {
+    logger().warn("Cannot run the benchmark: The benchmark is already running!");
+    return;
+  }
+
+  if (maxCheckpointCount < 10) {
+    return;
+  }
+
+  mBenchmarkCheckpointCount    = 10;
+  mBenchmarkMaxCheckpointCount = maxCheckpointCount;
+  mBenchmarkScenario           = std::async(std::launch::async, &Plugin::prepareBenchmarkScenario,
+      mBenchmarkCheckpointCount, getFrames(1));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Plugin::BenchmarkScenario Plugin::prepareBenchmarkScenario(
+    std::size_t checkpointCount, std::vector<std::pair<std::string, std::string>> frames) {
+
+  using Clock  = std::chrono::steady_clock;
+  auto seconds = [](Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double>(end - start).count();
+  };
+
+  ScenarioGeneratorOptions options;
+  options.mCheckpointCount = checkpointCount;
+  options.mFrames          = std::move(frames);
+
+  Settings                                  generated;
+  std::vector<cs::core::Settings::Bookmark> bookmarks;
+  generateScenario(options, generated, bookmarks);
+
+  // Time the (de)serialization of the plugin settings.
+  auto           serializeStart = Clock::now();
+  nlohmann::json json           = generated;
+  std::string    text           = json.dump();
+  auto           serializeEnd   = Clock::now();
+
+  Settings parsed;
+  from_json(nlohmann::json::parse(text), parsed);
+  auto deserializeEnd = Clock::now();
+
+  BenchmarkScenario scenario;
+  scenario.mCheckpoints = std::move(parsed.mCheckpoints);
+
+  // Time building the spatial indices and querying the closest checkpoint near the path. The
+  // generated bookmarks are not added to the scene, so they are resolved here.
+  std::unordered_map<std::string, cs::core::Settings::Bookmark::Location> bookmarkLocations;
+  for (auto const& bookmark : bookmarks) {
+    if (bookmark.mLocation) {
+      bookmarkLocations[bookmark.mName] = bookmark.mLocation.value();
+    }
+  }
+
+  auto& checkpoints = scenario.mCheckpoints;
+  auto  indexStart  = Clock::now();
+
+  for (std::size_t i = 0; i < checkpoints.size(); ++i) {
+    auto location = checkpoints.getLocation(i);
+
+    if (!location && checkpoints.getBookmarkName(i)) {
+      auto bookmark = bookmarkLocations.find(std::string(checkpoints.getBookmarkName(i).value()));
+      if (bookmark != bookmarkLocations.end()) {
+        location = bookmark->second;
+      }
+    }
+
+    if (location && location->mPosition) {
+      scenario.mSpatialIndices[{location->mCenter, location->mFrame}].add(
+          location->mPosition.value(), static_cast<uint32_t>(i));
+    }
+  }
+
+  for (auto& [frame, index] : scenario.mSpatialIndices) {
+    index.build();
+  }
+
+  auto indexEnd = Clock::now();
+
+  std::size_t queryCount  = 0;
+  std::size_t queryStride = std::max<std::size_t>(checkpointCount / 1000, 1);
+  for (auto const& [frame, index] : scenario.mSpatialIndices) {
+    for (std::size_t i = 0; i < checkpointCount; i += queryStride) {
+      auto location = checkpoints.getLocation(i);
+      if (location && location->mPosition) {
+        index.nearest(location->mPosition.value() + glm::dvec3(100.0, 100.0, 100.0));
+        ++queryCount;
+      }
+    }
+  }
+  auto queryEnd = Clock::now();
+
+  auto& result                    = scenario.mResult;
+  result["checkpoints"]           = checkpointCount;
+  result["serializedBytes"]       = text.size();
+  result["serializeSeconds"]      = seconds(serializeStart, serializeEnd);
+  result["deserializeSeconds"]    = seconds(serializeEnd, deserializeEnd);
+  result["serializeThroughput"]   = checkpointCount / seconds(serializeStart, serializeEnd);
+  result["deserializeThroughput"] = checkpointCount / seconds(serializeEnd, deserializeEnd);
+  result["indexBuildSeconds"]     = seconds(indexStart, indexEnd);
+  result["nearestQuerySeconds"] =
+      seconds(indexEnd, queryEnd) / std::max<std::size_t>(queryCount, 1);
+  result["storeBytes"] = checkpoints.getMemoryUsage();
+
+  return scenario;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::stepBenchmark() {
+  if (!mBenchmarkScenario.valid() ||
+      mBenchmarkScenario.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return;
+  }
+
+  // The checkpoints are only replaced once the recording has been stopped.
+  if (mEnableRecording) {
+    return;
+  }
+
+  // The number of update() calls and navigation steps which are timed for each scenario size.
+  std::size_t const updateCount        = 1000;
+  std::size_t const maxNavigationSteps = 10000;
+
+  using Clock  = std::chrono::steady_clock;
+  auto seconds = [](Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double>(end - start).count();
+  };
+
+  BenchmarkScenario scenario;
+
+  try {
+    scenario = mBenchmarkScenario.get();
+  } catch (std::exception const& e) {
+    logger().error("Failed to prepare the benchmark scenario: {}", e.what());
+    return;
+  }
+
+  // Only the checkpoints and the spatial indices are swapped. The other settings stay in place,
+  // so that the connections to their properties stay valid.
+  auto originalIdx        = mCurrentCheckpointIdx;
+  auto originalStatistics = mStatistics;
+
+  std::swap(mPluginSettings->mCheckpoints, scenario.mCheckpoints);
+  std::swap(mSpatialIndices, scenario.mSpatialIndices);
+
+  mIsBenchmarkRunning   = true;
+  mCurrentCheckpointIdx = 0;
+  for (std::size_t i = 0; i < mCheckpointViews.size(); i++) {
+    prepareCheckpoint(i);
+  }
+  updateCheckpointVisibility();
+
+  // Time the per-frame update of the checkpoints. The observer does not move during the
+  // benchmark, so the transformation inputs are invalidated before each frame in order to time
+  // the recomputation of the transformations. Afterwards, the frames which skip the recomputation
+  // are timed separately.
+  auto updateStart = Clock::now();
+  for (std::size_t i = 0; i < updateCount; ++i) {
+    mLastTransformInputs = {};
+    update();
+  }
+  auto updateEnd = Clock::now();
+
+  auto skippedUpdateStart = Clock::now();
+  for (std::size_t i = 0; i < updateCount; ++i) {
+    update();
+  }
+  auto skippedUpdateEnd = Clock::now();
+
+  // Time stepping forward and backward through the checkpoints.
+  std::size_t navigationSteps =
+      std::min(mPluginSettings->mCheckpoints.size() - 1, maxNavigationSteps);
+  auto navigationStart = Clock::now();
+  for (std::size_t i = 0; i < navigationSteps; ++i) {
+    nextCheckpoint();
+  }
+  while (mCurrentCheckpointIdx > 0) {
+    previousCheckpoint();
+  }
+  auto navigationEnd = Clock::now();
+
+  // Restore the original scenario.
+  std::swap(mPluginSettings->mCheckpoints, scenario.mCheckpoints);
+  std::swap(mSpatialIndices, scenario.mSpatialIndices);
+
+  mCurrentCheckpointIdx = originalIdx;
+  mStatistics           = originalStatistics;
+  mIsBenchmarkRunning   = false;
+
+  // The benchmark takes a while, this should not be counted as a long frame.
+  mLastFrameTime = {};
+
+  for (std::size_t i = 0; i < mCheckpointViews.size(); i++) {
+    prepareCheckpoint(mCurrentCheckpointIdx + i);
+  }
+  updateCheckpointVisibility();
+
+  auto& result                   = scenario.mResult;
+  result["updateSeconds"]        = seconds(updateStart, updateEnd) / updateCount;
+  result["updateSecondsSkipped"] = seconds(skippedUpdateStart, skippedUpdateEnd) / updateCount;
+  result["navigationSeconds"] =
+      seconds(navigationStart, navigationEnd) / std::max<std::size_t>(2 * navigationSteps, 1);
+  result["timestamp"] = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+
+  std::ofstream report("userstudy_benchmark.jsonl", std::ios::app);
+  report << result.dump() << std::endl;
+  logger().info("Benchmark: {}", result.dump());
+
+  // Start preparing the next scenario size.
+  mBenchmarkCheckpointCount *= 10;
+
+  if (mBenchmarkCheckpointCount <= mBenchmarkMaxCheckpointCount) {
+    mBenchmarkScenario = std::async(std::launch::async, &Plugin::prepareBenchmarkScenario,
+        mBenchmarkCheckpointCount, getFrames(1));
+  } else {
+    logger().info("Benchmark done.");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::analyzeTrajectory(std::string const& path) {
+  if (mTrajectoryAnalysis.valid() &&
+      mTrajectoryAnalysis.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    logger().warn("Cannot analyze trajectory: Another analysis is still running!");
+    return;
+  }
+
+  auto reference = getReferencePath();
+
+  if (reference.mPoints.empty()) {
+    logger().warn("Cannot analyze trajectory: No checkpoint has a position!");
+    return;
+  }
+
+  // The reference path is copied, so the scenario may change while the analysis is running.
+  mTrajectoryAnalysis = std::async(std::launch::async, [path, reference = std::move(reference)]() {
+    auto result = analyzeTrajectoryFiles({path}, reference).front();
+
+    if (!result.mDeviation) {
+      logger().error("Failed to analyze trajectory: {}", result.mError);
+      return;
+    }
+
+    auto const& d = *result.mDeviation;
+    logger().info("Trajectory {}: {} samples, lateral deviation {:.3f} m (mean) {:.3f} m (rms) "
+                  "{:.3f} m (max), DTW distance {:.3f} m per sample, overshoot at {} turns "
+                  "{:.3f} m (mean) {:.3f} m (max)",
+        path, d.mSampleCount, d.mMeanLateralDeviation, d.mRmsLateralDeviation,
+        d.mMaxLateralDeviation, d.mMeanDtwDistance, d.mTurnCount, d.mMeanOvershoot,
+        d.mMaxOvershoot);
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ReferencePath Plugin::getReferencePath() const {
+  ReferencePath path;
+
+  for (std::size_t i = 0; i < mPluginSettings->mCheckpoints.size(); ++i) {
+    auto location = getCheckpointLocation(i);
+
+    if (!location || !location->mPosition) {
+      continue;
+    }
+
+    if (path.mPoints.empty()) {
+      path.mCenter = location->mCenter;
+      path.mFrame  = location->mFrame;
+    } else if (location->mCenter != path.mCenter || location->mFrame != path.mFrame) {
+      continue;
+    }
+
+    path.mPoints.push_back(location->mPosition.value());
+    path.mCheckpoints.push_back(static_cast<uint32_t>(i));
+  }
+
+  return path;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::pair<std::string, std::string>> Plugin::getFrames(std::size_t maxCount) const {
+  std::vector<std::pair<std::string, std::string>> frames;
+
+  for (auto const& [name, object] : mAllSettings->mObjects) {
+    if (frames.size() >= maxCount) {
+      break;
+    }
+
+    std::pair<std::string, std::string> frame{object->getCenterName(), object->getFrameName()};
+    if (std::find(frames.begin(), frames.end(), frame) == frames.end()) {
+      frames.push_back(frame);
+    }
+  }
+
+  return frames;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::migrateCheckpoints() {
+  std::size_t           migrated = 0;
+  std::set<std::string> migratedBookmarks;
+
+  auto& checkpoints = mPluginSettings->mCheckpoints;
+
+  for (std::size_t i = 0; i < checkpoints.size(); ++i) {
+    auto checkpoint = checkpoints.get(i);
+
+    if (checkpoint.mLocation || !checkpoint.mBookmarkName) {
+      continue;
+    }
+
+    auto bookmark = getBookmarkByName(checkpoint.mBookmarkName.value());
+
+    if (bookmark && bookmark->mLocation) {
+      migratedBookmarks.insert(checkpoint.mBookmarkName.value());
+      checkpoint.mLocation     = bookmark->mLocation;
+      checkpoint.mBookmarkName = std::nullopt;
+      checkpoints.set(i, checkpoint);
+      ++migrated;
+    } else {
+      logger().warn("Failed to store the location of checkpoint {} inline: Bookmark \"{}\" does "
+                    "not exist or has no location!",
+          i, checkpoint.mBookmarkName.value());
+    }
+  }
+
+  // Now that no checkpoint references them anymore, the recorded bookmarks of the migrated
+  // checkpoints can be removed. All other bookmarks are kept.
+  bool bookmarksFound = false;
+
+  do {
+    bookmarksFound = false;
+
+    for (auto const& [id, bookmark] : mGuiManager->getBookmarks()) {
+      if (bookmark.mName.find("user-study-bookmark-") != std::string::npos &&
+          migratedBookmarks.count(bookmark.mName) > 0) {
+        mGuiManager->removeBookmark(id);
+        bookmarksFound = true;
+        break;
+      }
+    }
+  } while (bookmarksFound);
+
+  logger().info("Stored the locations of {} checkpoints inline.", migrated);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string Plugin::getCheckpointName(std::size_t index) const {
+  auto bookmarkName = mPluginSettings->mCheckpoints.getBookmarkName(index);
+
+  if (bookmarkName) {
+    return std::string(bookmarkName.value());
+  }
+
+  return "user-study-checkpoint-" + std::to_string(index);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<cs::core::Settings::Bookmark::Location> Plugin::getCheckpointLocation(
+    std::size_t index) const {
+
+  auto const& checkpoints = mPluginSettings->mCheckpoints;
+
+  auto location = checkpoints.getLocation(index);
+  if (location) {
+    return location;
+  }
+
+  auto bookmarkName = checkpoints.getBookmarkName(index);
+  if (bookmarkName) {
+    auto bookmark = getBookmarkByName(std::string(bookmarkName.value()));
+    if (bookmark) {
+      return bookmark->mLocation;
+    }
+  }
+
+  return std::nullopt;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::optional<cs::core::Settings::Bookmark> Plugin::getBookmarkByName(
     std::string const& name) const {
@@ -621,12 +1560,12 @@ std::optional<cs::core::Settings::Bookmark> Plugin::getBookmarkByName(
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::shared_ptr<const cs::scene::CelestialObject> Plugin::getObjectForBookmark(
-    cs::core::Settings::Bookmark const& bookmark) const {
+std::shared_ptr<const cs::scene::CelestialObject> Plugin::getObjectForLocation(
+    cs::core::Settings::Bookmark::Location const& location) const {
 
   for (auto const& [name, object] : mAllSettings->mObjects) {
-    if (object->getCenterName() == bookmark.mLocation->mCenter &&
-        object->getFrameName() == bookmark.mLocation->mFrame) {
+    if (object->getCenterName() == location.mCenter &&
+        object->getFrameName() == location.mFrame) {
       return object;
     }
   }
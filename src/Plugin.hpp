@@ -11,6 +11,15 @@
 #include "../../../src/cs-core/PluginBase.hpp"
 #include "../../../src/cs-core/Settings.hpp"
 #include "../../../src/cs-utils/Property.hpp"
+#include "CheckpointStore.hpp"
+#include "FrameTimeStatistics.hpp"
+#include "SpatialIndex.hpp"
+#include "TrajectoryAnalysis.hpp"
+#include "TrajectoryCodec.hpp"
+
+#include <future>
+#include <map>
+#include <set>
 #include <vector>
 
 class VistaOpenGLNode;
@@ -23,6 +32,8 @@ class GuiItem;
 
 namespace csp::userstudy {
 
+class ScenarioWatcher;
+
 /// This plugin creates configurable navigation scenarios for a user study. It uses web views to
 /// mark checkpoints with different tasks. There are different types of checkpoints: Simple
 /// checkpoints are just rings which the user needs to fly through. Other checkpoints types display
@@ -45,28 +56,41 @@ class Plugin : public cs::core::PluginBase {
     /// List of configs containing related scenarios.
     std::vector<Scenario> mOtherScenarios;
 
-    /// The settings for a stage of the scenario
-    struct Checkpoint {
-      enum class Type { eSimple, eRequestFMS, eRequestCOG, eMessage, eSwitchScenario };
+    /// The settings for a stage of the scenario. See CheckpointStore.hpp for details.
+    using Checkpoint = userstudy::Checkpoint;
 
-      /// The type of the stage
-      Type mType{Type::eSimple};
+    /// List of stages making up the scenario
+    CheckpointStore mCheckpoints;
 
-      /// The related bookmark for the position & orientation
-      std::string mBookmarkName;
+    /// The checkpoint recording interval in seconds.
+    cs::utils::DefaultProperty<uint32_t> pRecordingInterval{5};
 
-      /// The scaling factor for the stage mark
-      float mScaling;
+    /// If enabled, the observer's pose is written to a compressed trajectory file in each frame
+    /// while a scenario is running.
+    cs::utils::DefaultProperty<bool> pEnableTrajectoryLogging{false};
 
-      /// For now, this is only used for the message of eMessage checkpoints.
-      std::optional<std::string> mData;
-    };
+    /// The precision of the logged positions in meters. Set to zero for lossless positions.
+    cs::utils::DefaultProperty<double> pTrajectoryPositionPrecision{0.001};
 
-    /// List of stages making up the scenario
-    std::vector<Checkpoint> mCheckpoints;
+    /// The number of bits per stored component of the logged rotations. Set to zero for lossless
+    /// rotations.
+    cs::utils::DefaultProperty<uint32_t> pTrajectoryRotationBits{16};
 
-    /// The checkpoint recording interval in seconds.
-    cs::utils::DefaultProperty<uint32_t> pRecordingInterval{5};
+    /// The number of fractional bits of the logged log2(scale). Set to zero for a lossless scale.
+    cs::utils::DefaultProperty<uint32_t> pTrajectoryScaleBits{16};
+
+    /// Frames which take longer than this (in milliseconds) are counted in the frame-time
+    /// statistics of each checkpoint. The default corresponds to 90 Hz.
+    cs::utils::DefaultProperty<float> pFrameTimeBudget{11.1F};
+
+    /// If enabled, the current checkpoint is advanced automatically if the user is closer to a
+    /// later checkpoint, for instance because they missed some rings. Checkpoints which require
+    /// user input are never skipped.
+    cs::utils::DefaultProperty<bool> pEnableAutoResync{false};
+
+    /// Automatic resynchronization only considers this many checkpoints after the current one.
+    /// Without this limit, a path which loops back on itself could skip a whole lap.
+    cs::utils::DefaultProperty<uint32_t> pResyncWindow{10};
   };
 
   void init() override;
@@ -77,6 +101,10 @@ class Plugin : public cs::core::PluginBase {
   void onLoad();
   void unload();
 
+  // This creates checkpoints for all poses in mRecordedPoses. It is called once a
+  // recording is stopped.
+  void commitRecording();
+
   // This updates a CheckpointView according the data for the checkpoint at the given index.
   void prepareCheckpoint(std::size_t index);
 
@@ -93,20 +121,90 @@ class Plugin : public cs::core::PluginBase {
   // checkpoint which is farthest in the future.
   void nextCheckpoint();
 
+  // This rebuilds mSpatialIndices from the positions of all checkpoints. It has to be called
+  // whenever checkpoints have been added, removed or moved.
+  void rebuildSpatialIndices();
+
+  // If the user is closer to a later checkpoint than to the current one, this advances the current
+  // checkpoint. The given location and object belong to the current checkpoint.
+  void resyncToNearest(cs::core::Settings::Bookmark::Location const& location,
+      cs::scene::CelestialObject const& object);
+
+  // This writes the frame-time statistics of all frames since the last call to the results log.
+  // It is called whenever the user advances to the next checkpoint.
+  void logFrameTimes(std::size_t index);
+
   // This reduces mCurrentCheckpointIdx by one and makes the now obsolete CheckpointView show the
   // checkpoint at mCurrentCheckpointIdx.
   void previousCheckpoint();
 
+  // This loads the scenario at the given path and starts watching the file for changes.
+  void loadScenario(std::string const& path);
+
+  // This incorporates the given settings and bookmarks which have been parsed after the scenario
+  // file changed. Only the checkpoints which differ from the current ones or whose bookmark has
+  // been moved are updated, the current checkpoint stays active.
+  void applyScenarioChanges(
+      Settings const& settings, std::vector<cs::core::Settings::Bookmark> const& bookmarks);
+
+  // Replaces the bookmarks of the GuiManager which are referenced by the given checkpoints and
+  // whose location differs from the given bookmarks. Returns the names of the replaced bookmarks.
+  std::set<std::string> updateReferencedBookmarks(CheckpointStore const& checkpoints,
+      std::vector<cs::core::Settings::Bookmark> const& bookmarks);
+
+  // This writes the current scene with a synthetic scenario to the given file. See
+  // scenarioGenerator.hpp for details on the generated checkpoints.
+  void writeGeneratedScenario(std::string const& path, std::size_t checkpointCount,
+      std::size_t frameCount, double bookmarkRatio) const;
+
+  // This starts benchmarking synthetic scenarios of 10, 100, 1000, ... checkpoints up to the given
+  // count. The scenarios are generated, (de)serialized and indexed on a worker thread, one after
+  // another. Once a scenario is ready, update() calls stepBenchmark().
+  void runBenchmark(std::size_t maxCheckpointCount);
+
+  // This temporarily replaces the checkpoints of the current scenario with the prepared synthetic
+  // ones and times the per-frame update and the checkpoint navigation. The results are appended as
+  // one JSON object per line to userstudy_benchmark.jsonl in the current working directory.
+  // Afterwards, preparing the next scenario size is started.
+  void stepBenchmark();
+
+  // This compares the trajectory in the given file to the checkpoints of the current scenario on a
+  // background thread. See TrajectoryAnalysis.hpp for details on the computed metrics. The results
+  // are written to the log.
+  void analyzeTrajectory(std::string const& path);
+
+  // Returns the positions of the checkpoints of the current scenario which are in the same
+  // reference frame as the first checkpoint with a position.
+  ReferencePath getReferencePath() const;
+
+  // Returns up to the given number of distinct pairs of SPICE center and frame names of the
+  // currently configured objects. This is used for generating scenarios.
+  std::vector<std::pair<std::string, std::string>> getFrames(std::size_t maxCount) const;
+
+  // This stores the locations of all checkpoints which reference a bookmark inline and removes
+  // the bookmarks created by the recording functionality.
+  void migrateCheckpoints();
+
+  // Returns a name for the checkpoint at the given index which is used in the log files. This is
+  // the bookmark name for checkpoints referencing a bookmark.
+  std::string getCheckpointName(std::size_t index) const;
+
+  // Returns the location of the checkpoint at the given index. This is either the inline location
+  // or the location of the referenced bookmark. This may return std::nullopt if neither is
+  // available.
+  std::optional<cs::core::Settings::Bookmark::Location> getCheckpointLocation(
+      std::size_t index) const;
+
   // Retrieves the bookmark with the given name from the GuiManager. This may return std::nullopt if
   // no bookmark with the given name exists.
   std::optional<cs::core::Settings::Bookmark> getBookmarkByName(std::string const& name) const;
 
   // Retrieves a CelestialObject from the SolarSystem which has the same SPICE center and frame name
-  // as the given bookmark. This can then be used to compute the observer-relative position of the
-  // bookmark. If no CelestialObject with this center and frame name exists, this will return
+  // as the given location. This can then be used to compute the observer-relative position of the
+  // location. If no CelestialObject with this center and frame name exists, this will return
   // std::nullptr.
-  std::shared_ptr<const cs::scene::CelestialObject> getObjectForBookmark(
-      cs::core::Settings::Bookmark const& bookmark) const;
+  std::shared_ptr<const cs::scene::CelestialObject> getObjectForLocation(
+      cs::core::Settings::Bookmark::Location const& location) const;
 
   std::shared_ptr<Settings> mPluginSettings = std::make_shared<Settings>();
 
@@ -118,6 +216,33 @@ class Plugin : public cs::core::PluginBase {
     std::unique_ptr<cs::gui::GuiItem>           mGuiItem;
     std::unique_ptr<VistaOpenGLNode>            mGuiNode;
     std::unique_ptr<VistaTransformNode>         mTransformNode;
+
+    // The index of the checkpoint for which mTransformNode has been computed last. This is reset
+    // whenever the view is prepared for a checkpoint.
+    std::optional<std::size_t> mTransformCheckpointIdx;
+  };
+
+  // All inputs of the checkpoint transformations which do not depend on the checkpoint itself. If
+  // they do not change from one frame to the next, the transformations of the views do not need
+  // to be recomputed.
+  struct TransformInputs {
+    std::string mCenter;
+    std::string mFrame;
+    glm::dvec3  mPosition{0.0};
+    glm::dquat  mRotation{1.0, 0.0, 0.0, 0.0};
+    double      mScale          = 1.0;
+    double      mSimulationTime = 0.0;
+
+    bool operator==(TransformInputs const& other) const;
+  };
+
+  // Counters which are reported in the log when a scenario is unloaded.
+  struct Statistics {
+    std::size_t mTransformUpdates = 0;
+    std::size_t mTransformSkips   = 0;
+
+    // Returns the fraction of skipped transformation updates.
+    double getSkipRatio() const;
   };
 
   // These will show the next three checkpoints. The current checkpoint will be at index
@@ -126,14 +251,88 @@ class Plugin : public cs::core::PluginBase {
   std::size_t                   mCurrentCheckpointIdx = 0;
   cs::utils::Property<uint32_t> mCurrentFMS           = 0;
 
+  TransformInputs mLastTransformInputs;
+  Statistics      mStatistics;
+
+  // This watches the file of the scenario which has been loaded with loadScenario(). The watcher
+  // is created in loadScenario() but only becomes active in onLoad(). If a scene is loaded in
+  // another way, the watcher is removed in onLoad(), so that changes of the previous file are not
+  // applied to the new scene.
+  std::unique_ptr<ScenarioWatcher> mPendingScenarioWatcher;
+  std::unique_ptr<ScenarioWatcher> mScenarioWatcher;
+
+  // For each pair of SPICE center and frame name, this contains the positions of all checkpoints in
+  // this reference frame. It is used for finding the checkpoint closest to the user.
+  std::map<std::pair<std::string, std::string>, SpatialIndex> mSpatialIndices;
+
+  // The duration of each frame is appended to this list in update(). When the user advances to the
+  // next checkpoint, the statistics of the frame times are written to the results log and the list
+  // is cleared. Its capacity is kept, so it is only reallocated if a segment takes longer than all
+  // segments before.
+  std::vector<float>                    mSegmentFrameTimes;
+  std::chrono::steady_clock::time_point mLastFrameTime;
+
+  // Space for this many frame times is reserved when the plugin is loaded. At 90 Hz, this is enough
+  // for three minutes per checkpoint.
+  static constexpr std::size_t FRAME_TIME_CAPACITY = 16384;
+
+  // A synthetic scenario which has been prepared on the worker thread of the benchmark together
+  // with the measurements taken there.
+  struct BenchmarkScenario {
+    CheckpointStore                                             mCheckpoints;
+    std::map<std::pair<std::string, std::string>, SpatialIndex> mSpatialIndices;
+    nlohmann::json                                              mResult;
+  };
+
+  // Generates a scenario with the given number of checkpoints and times its (de)serialization and
+  // the construction and queries of its spatial indices. This runs on the worker thread.
+  static BenchmarkScenario prepareBenchmarkScenario(
+      std::size_t checkpointCount, std::vector<std::pair<std::string, std::string>> frames);
+
+  // The benchmarked scenario sizes go up to this count. The next scenario is prepared in
+  // mBenchmarkScenario.
+  std::size_t                    mBenchmarkCheckpointCount    = 0;
+  std::size_t                    mBenchmarkMaxCheckpointCount = 0;
+  std::future<BenchmarkScenario> mBenchmarkScenario;
+
+  // This is set while stepBenchmark() is executed. The synthetic scenarios should not end up in
+  // the trajectory file or in the frame-time statistics.
+  bool mIsBenchmarkRunning = false;
+
+  // This writes the observer's pose in each frame. It is created when a scenario is loaded.
+  std::unique_ptr<TrajectoryWriter>     mTrajectoryWriter;
+  std::chrono::steady_clock::time_point mTrajectoryStartTime;
+  uint32_t                              mTrajectoryCount = 0;
+
+  // The currently running analyzeTrajectory() call, if any.
+  std::future<void> mTrajectoryAnalysis;
+
   // This is set to true during checkpoint recording.
   bool                                  mEnableRecording      = false;
   bool                                  mEnableCOGMeasurement = false;
   std::chrono::steady_clock::time_point mLastRecordTime;
 
+  // During checkpoint recording, the observer's poses are only stored in this list. Once the
+  // recording is stopped, they are converted to checkpoints in one batch.
+  struct RecordedPose {
+    cs::core::Settings::Bookmark::Location mLocation;
+    float                                  mScaling = 1.F;
+  };
+
+  // Space for this many poses is reserved when a recording is started. With the default recording
+  // interval, this is enough for more than an hour.
+  static constexpr std::size_t RECORDING_CAPACITY = 1024;
+
+  std::vector<RecordedPose> mRecordedPoses;
+
   int mOnLoadConnection = -1;
   int mOnSaveConnection = -1;
 };
+
+/// These are used for reading and writing the plugin's settings.
+void from_json(nlohmann::json const& j, Plugin::Settings& o);
+void to_json(nlohmann::json& j, Plugin::Settings const& o);
+
 } // namespace csp::userstudy
 
 #endif // CSP_USER_STUDY_PLUGIN_HPP
@@ -0,0 +1,136 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#include "ScenarioWatcher.hpp"
+
+#include "logger.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace csp::userstudy {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ScenarioWatcher::ScenarioWatcher(std::string path)
+    : mPath(std::move(path)) {
+
+#ifdef __linux__
+  // Many editors do not write the file directly but replace it with a new one. Therefore, we watch
+  // the parent directory and filter the events by the file name.
+  auto directory = std::filesystem::path(mPath).parent_path();
+  if (directory.empty()) {
+    directory = ".";
+  }
+
+  mInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+  if (mInotifyFd < 0 ||
+      inotify_add_watch(mInotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    logger().warn("Failed to watch scenario file {} for changes!", mPath);
+    return;
+  }
+
+  mThread = std::thread(&ScenarioWatcher::run, this);
+#else
+  logger().info("Watching scenario files for changes is only supported on Linux.");
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ScenarioWatcher::~ScenarioWatcher() {
+  mStop = true;
+
+  if (mThread.joinable()) {
+    mThread.join();
+  }
+
+#ifdef __linux__
+  if (mInotifyFd >= 0) {
+    close(mInotifyFd);
+  }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<ScenarioWatcher::Changes> ScenarioWatcher::takeChanges() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return std::move(mChanges);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ScenarioWatcher::run() {
+#ifdef __linux__
+  auto fileName = std::filesystem::path(mPath).filename().string();
+
+  // The buffer has to be suitably aligned for inotify_event.
+  alignas(inotify_event) char buffer[4096];
+
+  while (!mStop) {
+
+    // Wake up regularly to check whether we should stop.
+    pollfd fd{mInotifyFd, POLLIN, 0};
+    if (poll(&fd, 1, 200) <= 0) {
+      continue;
+    }
+
+    bool changed = false;
+
+    ssize_t length = 0;
+    while ((length = read(mInotifyFd, buffer, sizeof(buffer))) > 0) {
+      for (char* ptr = buffer; ptr < buffer + length;) {
+        auto const* event = reinterpret_cast<inotify_event const*>(ptr);
+        if (event->len > 0 && fileName == event->name) {
+          changed = true;
+        }
+        ptr += sizeof(inotify_event) + event->len;
+      }
+    }
+
+    if (changed) {
+      parse();
+    }
+  }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ScenarioWatcher::parse() {
+  try {
+    std::ifstream file(mPath);
+    auto          json = nlohmann::json::parse(file);
+
+    auto changes = std::make_shared<Changes>();
+    from_json(json.at("plugins").at("csp-user-study"), changes->mSettings);
+
+    // Checkpoints may reference the bookmarks of the scene, so their locations may have changed as
+    // well.
+    if (json.contains("bookmarks")) {
+      json.at("bookmarks").get_to(changes->mBookmarks);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mChanges = std::move(changes);
+
+  } catch (std::exception const& e) {
+    logger().warn("Failed to parse changed scenario file {}: {}", mPath, e.what());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::userstudy
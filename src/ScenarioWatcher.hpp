@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#ifndef CSP_USER_STUDY_SCENARIO_WATCHER_HPP
+#define CSP_USER_STUDY_SCENARIO_WATCHER_HPP
+
+#include "Plugin.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace csp::userstudy {
+
+/// Watches a scenario file for changes. Whenever the file has been written, it is parsed on a
+/// background thread and the contained settings of the plugin and the bookmarks of the scene can
+/// be retrieved with takeChanges(). Files which cannot be parsed, for instance because they are
+/// only partially written, are ignored. This uses inotify and is therefore only available on
+/// Linux; on other platforms takeChanges() will always return nullptr.
+class ScenarioWatcher {
+ public:
+  /// The parts of a scenario file which can be reloaded.
+  struct Changes {
+    Plugin::Settings                          mSettings;
+    std::vector<cs::core::Settings::Bookmark> mBookmarks;
+  };
+
+  explicit ScenarioWatcher(std::string path);
+  ~ScenarioWatcher();
+
+  ScenarioWatcher(ScenarioWatcher const& other) = delete;
+  ScenarioWatcher(ScenarioWatcher&& other)      = delete;
+
+  ScenarioWatcher& operator=(ScenarioWatcher const& other) = delete;
+  ScenarioWatcher& operator=(ScenarioWatcher&& other) = delete;
+
+  /// Returns the settings and bookmarks which have been parsed after the last change of the file.
+  /// If the file has not changed since the last call, nullptr is returned.
+  std::shared_ptr<Changes> takeChanges();
+
+ private:
+  void run();
+  void parse();
+
+  std::string mPath;
+
+  std::mutex               mMutex;
+  std::shared_ptr<Changes> mChanges;
+
+  int               mInotifyFd = -1;
+  std::atomic<bool> mStop{false};
+  std::thread       mThread;
+};
+
+} // namespace csp::userstudy
+
+#endif // CSP_USER_STUDY_SCENARIO_WATCHER_HPP
@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#include "SpatialIndex.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace csp::userstudy {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Ranges with at most this many nodes are not split further but searched linearly. This is faster
+// than descending the last levels of the tree.
+constexpr std::size_t LEAF_SIZE = 8;
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SpatialIndex::add(glm::dvec3 const& position, uint32_t index) {
+  mNodes.push_back({position, index, index, index});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SpatialIndex::build() {
+  build(0, mNodes.size(), 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SpatialIndex::build(std::size_t begin, std::size_t end, int depth) {
+  if (end - begin <= LEAF_SIZE) {
+    return;
+  }
+
+  int         axis   = depth % 3;
+  std::size_t middle = begin + (end - begin) / 2;
+
+  std::nth_element(mNodes.begin() + begin, mNodes.begin() + middle, mNodes.begin() + end,
+      [axis](Node const& a, Node const& b) { return a.mPosition[axis] < b.mPosition[axis]; });
+
+  build(begin, middle, depth + 1);
+  build(middle + 1, end, depth + 1);
+
+  auto [minNode, maxNode] = std::minmax_element(mNodes.begin() + begin, mNodes.begin() + end,
+      [](Node const& a, Node const& b) { return a.mIndex < b.mIndex; });
+
+  mNodes[middle].mMinIndex = minNode->mIndex;
+  mNodes[middle].mMaxIndex = maxNode->mIndex;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<SpatialIndex::Result> SpatialIndex::nearest(glm::dvec3 const& position) const {
+  return nearest(position, 0, std::numeric_limits<uint32_t>::max());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<SpatialIndex::Result> SpatialIndex::nearest(
+    glm::dvec3 const& position, uint32_t minIndex, uint32_t maxIndex) const {
+
+  if (mNodes.empty() || minIndex > maxIndex) {
+    return std::nullopt;
+  }
+
+  struct Range {
+    std::size_t mBegin;
+    std::size_t mEnd;
+    int         mDepth;
+    double      mMinDistance2;
+  };
+
+  // The depth of the tree is logarithmic in the number of nodes, so a small fixed-size stack is
+  // sufficient. Each level pushes at most two ranges.
+  std::array<Range, 128> stack;
+  std::size_t            stackSize = 0;
+  stack[stackSize++]               = {0, mNodes.size(), 0, 0.0};
+
+  auto isInRange = [minIndex, maxIndex](uint32_t index) {
+    return index >= minIndex && index <= maxIndex;
+  };
+
+  double                     bestDistance2 = std::numeric_limits<double>::max();
+  std::optional<std::size_t> best;
+
+  while (stackSize > 0) {
+    Range range = stack[--stackSize];
+
+    if (range.mBegin >= range.mEnd || range.mMinDistance2 >= bestDistance2) {
+      continue;
+    }
+
+    if (range.mEnd - range.mBegin <= LEAF_SIZE) {
+      for (std::size_t i = range.mBegin; i < range.mEnd; ++i) {
+        glm::dvec3 diff      = position - mNodes[i].mPosition;
+        double     distance2 = glm::dot(diff, diff);
+
+        if (distance2 < bestDistance2 && isInRange(mNodes[i].mIndex)) {
+          bestDistance2 = distance2;
+          best          = i;
+        }
+      }
+      continue;
+    }
+
+    std::size_t middle = range.mBegin + (range.mEnd - range.mBegin) / 2;
+    Node const& node   = mNodes[middle];
+
+    if (node.mMaxIndex < minIndex || node.mMinIndex > maxIndex) {
+      continue;
+    }
+
+    glm::dvec3 diff      = position - node.mPosition;
+    double     distance2 = glm::dot(diff, diff);
+
+    if (distance2 < bestDistance2 && isInRange(node.mIndex)) {
+      bestDistance2 = distance2;
+      best          = middle;
+    }
+
+    int    axis  = range.mDepth % 3;
+    double delta = diff[axis];
+
+    Range left{range.mBegin, middle, range.mDepth + 1, 0.0};
+    Range right{middle + 1, range.mEnd, range.mDepth + 1, 0.0};
+
+    // The far side is pushed first so that the near side is processed first. The far side only
+    // needs to be visited if the splitting plane is closer than the best match so far.
+    if (delta < 0.0) {
+      right.mMinDistance2 = delta * delta;
+      stack[stackSize++]  = right;
+      stack[stackSize++]  = left;
+    } else {
+      left.mMinDistance2 = delta * delta;
+      stack[stackSize++] = left;
+      stack[stackSize++] = right;
+    }
+  }
+
+  if (!best) {
+    return std::nullopt;
+  }
+
+  return Result{mNodes[best.value()].mIndex, std::sqrt(bestDistance2)};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t SpatialIndex::size() const {
+  return mNodes.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::userstudy
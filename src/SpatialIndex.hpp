@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#ifndef CSP_USER_STUDY_SPATIAL_INDEX_HPP
+#define CSP_USER_STUDY_SPATIAL_INDEX_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace csp::userstudy {
+
+/// A static k-d tree over the positions of checkpoints in one reference frame. The tree is stored
+/// implicitly in a single array, so nearest-neighbor queries do not allocate and only touch a few
+/// cache lines.
+class SpatialIndex {
+ public:
+  /// The result of a nearest-neighbor query.
+  struct Result {
+    uint32_t mIndex;
+    double   mDistance;
+  };
+
+  /// Adds a point with the given checkpoint index. The tree has to be built afterwards.
+  void add(glm::dvec3 const& position, uint32_t index);
+
+  /// Builds the tree from all added points. This has to be called before nearest() is used.
+  void build();
+
+  /// Returns the checkpoint which is closest to the given position or std::nullopt if the index is
+  /// empty.
+  std::optional<Result> nearest(glm::dvec3 const& position) const;
+
+  /// Returns the checkpoint with an index in [minIndex, maxIndex] which is closest to the given
+  /// position or std::nullopt if there is no such checkpoint. Subtrees without any checkpoint in
+  /// this range are skipped.
+  std::optional<Result> nearest(
+      glm::dvec3 const& position, uint32_t minIndex, uint32_t maxIndex) const;
+
+  std::size_t size() const;
+
+ private:
+  struct Node {
+    glm::dvec3 mPosition;
+    uint32_t   mIndex;
+
+    // The smallest and largest checkpoint index in the subtree of this node. This is only set for
+    // the middle nodes of subtrees which are split.
+    uint32_t mMinIndex;
+    uint32_t mMaxIndex;
+  };
+
+  void build(std::size_t begin, std::size_t end, int depth);
+
+  // The node of the subtree [begin, end) is at the middle of the range. Its left subtree is in
+  // [begin, middle), its right subtree in [middle + 1, end). The split axis is depth % 3. Small
+  // subtrees are not sorted but searched linearly.
+  std::vector<Node> mNodes;
+};
+
+} // namespace csp::userstudy
+
+#endif // CSP_USER_STUDY_SPATIAL_INDEX_HPP
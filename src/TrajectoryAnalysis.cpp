@@ -0,0 +1,562 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#include "TrajectoryAnalysis.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+// SSE2 is part of every x86-64 CPU, so the kernels below do not need any runtime dispatch.
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CSP_USER_STUDY_USE_SSE2
+#endif
+
+namespace csp::userstudy {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// The segments of the reference polyline in a structure-of-arrays layout. The arrays are padded
+// to an even length by repeating the last segment, so the SIMD kernel can always process two
+// segments at once.
+struct Segments {
+  std::vector<double> mStartX, mStartY, mStartZ;
+  std::vector<double> mDirX, mDirY, mDirZ;
+
+  // One over the squared length of each segment, or zero for degenerate segments.
+  std::vector<double> mInvLength2;
+
+  std::size_t size() const {
+    return mStartX.size();
+  }
+
+  void push_back(glm::dvec3 const& start, glm::dvec3 const& end) {
+    glm::dvec3 dir     = end - start;
+    double     length2 = glm::dot(dir, dir);
+
+    mStartX.push_back(start.x);
+    mStartY.push_back(start.y);
+    mStartZ.push_back(start.z);
+    mDirX.push_back(dir.x);
+    mDirY.push_back(dir.y);
+    mDirZ.push_back(dir.z);
+    mInvLength2.push_back(length2 > 0.0 ? 1.0 / length2 : 0.0);
+  }
+};
+
+// The reference points in a structure-of-arrays layout, padded like the Segments above.
+struct Points {
+  std::vector<double> mX, mY, mZ;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Segments makeSegments(std::vector<glm::dvec3> const& points) {
+  Segments segments;
+
+  if (points.size() == 1) {
+    segments.push_back(points[0], points[0]);
+  }
+
+  for (std::size_t i = 1; i < points.size(); ++i) {
+    segments.push_back(points[i - 1], points[i]);
+  }
+
+  if (segments.size() % 2 == 1) {
+    std::size_t last = segments.size() - 1;
+    glm::dvec3  start(segments.mStartX[last], segments.mStartY[last], segments.mStartZ[last]);
+    glm::dvec3  dir(segments.mDirX[last], segments.mDirY[last], segments.mDirZ[last]);
+    segments.push_back(start, start + dir);
+  }
+
+  return segments;
+}
+
+Points makePoints(std::vector<glm::dvec3> const& points) {
+  Points result;
+
+  std::size_t paddedSize = points.size() + points.size() % 2;
+  result.mX.reserve(paddedSize);
+  result.mY.reserve(paddedSize);
+  result.mZ.reserve(paddedSize);
+
+  for (std::size_t i = 0; i < paddedSize; ++i) {
+    auto const& point = points[std::min(i, points.size() - 1)];
+    result.mX.push_back(point.x);
+    result.mY.push_back(point.y);
+    result.mZ.push_back(point.z);
+  }
+
+  return result;
+}
+
+// Returns the given number of points which are equally spaced along the given polyline.
+std::vector<glm::dvec3> resample(std::vector<glm::dvec3> const& points, std::size_t count) {
+  std::vector<double> lengths(points.size(), 0.0);
+
+  for (std::size_t i = 1; i < points.size(); ++i) {
+    lengths[i] = lengths[i - 1] + glm::length(points[i] - points[i - 1]);
+  }
+
+  if (points.size() < 2 || count < 2 || lengths.back() == 0.0) {
+    return points;
+  }
+
+  std::vector<glm::dvec3> result;
+  result.reserve(count);
+
+  std::size_t segment = 1;
+
+  for (std::size_t i = 0; i < count; ++i) {
+    double length = lengths.back() * static_cast<double>(i) / static_cast<double>(count - 1);
+
+    while (segment + 1 < points.size() && lengths[segment] < length) {
+      ++segment;
+    }
+
+    double segmentLength = lengths[segment] - lengths[segment - 1];
+    double t = segmentLength > 0.0 ? (length - lengths[segment - 1]) / segmentLength : 0.0;
+    result.push_back(points[segment - 1] + (points[segment] - points[segment - 1]) * t);
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the squared distance of the given point to the closest of the segments in the range
+// [begin, end). The range is extended to even bounds, so the SIMD kernel can always process two
+// segments at once.
+double minSquaredDistance(
+    glm::dvec3 const& point, Segments const& segments, std::size_t begin, std::size_t end) {
+  begin = begin & ~std::size_t(1);
+  end   = std::min(segments.size(), end + end % 2);
+
+#ifdef CSP_USER_STUDY_USE_SSE2
+  __m128d px   = _mm_set1_pd(point.x);
+  __m128d py   = _mm_set1_pd(point.y);
+  __m128d pz   = _mm_set1_pd(point.z);
+  __m128d zero = _mm_setzero_pd();
+  __m128d one  = _mm_set1_pd(1.0);
+  __m128d best = _mm_set1_pd(std::numeric_limits<double>::max());
+
+  for (std::size_t i = begin; i < end; i += 2) {
+    __m128d vx = _mm_sub_pd(px, _mm_loadu_pd(&segments.mStartX[i]));
+    __m128d vy = _mm_sub_pd(py, _mm_loadu_pd(&segments.mStartY[i]));
+    __m128d vz = _mm_sub_pd(pz, _mm_loadu_pd(&segments.mStartZ[i]));
+    __m128d dx = _mm_loadu_pd(&segments.mDirX[i]);
+    __m128d dy = _mm_loadu_pd(&segments.mDirY[i]);
+    __m128d dz = _mm_loadu_pd(&segments.mDirZ[i]);
+
+    // Project the point onto the segment and clamp to its end points.
+    __m128d t = _mm_add_pd(_mm_add_pd(_mm_mul_pd(vx, dx), _mm_mul_pd(vy, dy)), _mm_mul_pd(vz, dz));
+    t         = _mm_mul_pd(t, _mm_loadu_pd(&segments.mInvLength2[i]));
+    t         = _mm_min_pd(_mm_max_pd(t, zero), one);
+
+    __m128d ex = _mm_sub_pd(vx, _mm_mul_pd(t, dx));
+    __m128d ey = _mm_sub_pd(vy, _mm_mul_pd(t, dy));
+    __m128d ez = _mm_sub_pd(vz, _mm_mul_pd(t, dz));
+    __m128d d2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(ex, ex), _mm_mul_pd(ey, ey)), _mm_mul_pd(ez, ez));
+
+    best = _mm_min_pd(best, d2);
+  }
+
+  best = _mm_min_sd(best, _mm_unpackhi_pd(best, best));
+  return _mm_cvtsd_f64(best);
+#else
+  double best = std::numeric_limits<double>::max();
+
+  for (std::size_t i = begin; i < end; ++i) {
+    double vx = point.x - segments.mStartX[i];
+    double vy = point.y - segments.mStartY[i];
+    double vz = point.z - segments.mStartZ[i];
+    double dx = segments.mDirX[i];
+    double dy = segments.mDirY[i];
+    double dz = segments.mDirZ[i];
+
+    double t = (vx * dx + vy * dy + vz * dz) * segments.mInvLength2[i];
+    t        = std::min(std::max(t, 0.0), 1.0);
+
+    double ex = vx - t * dx;
+    double ey = vy - t * dy;
+    double ez = vz - t * dz;
+
+    best = std::min(best, ex * ex + ey * ey + ez * ez);
+  }
+
+  return best;
+#endif
+}
+
+// Writes the distances of the given point to the reference points in the range [begin, end) to
+// the output array at the same indices.
+void distances(glm::dvec3 const& point, Points const& points, std::size_t begin, std::size_t end,
+    double* output) {
+  std::size_t i = begin;
+
+#ifdef CSP_USER_STUDY_USE_SSE2
+  __m128d px = _mm_set1_pd(point.x);
+  __m128d py = _mm_set1_pd(point.y);
+  __m128d pz = _mm_set1_pd(point.z);
+
+  for (; i + 1 < end; i += 2) {
+    __m128d dx = _mm_sub_pd(px, _mm_loadu_pd(&points.mX[i]));
+    __m128d dy = _mm_sub_pd(py, _mm_loadu_pd(&points.mY[i]));
+    __m128d dz = _mm_sub_pd(pz, _mm_loadu_pd(&points.mZ[i]));
+    __m128d d2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+    _mm_storeu_pd(output + i, _mm_sqrt_pd(d2));
+  }
+#endif
+
+  for (; i < end; ++i) {
+    double dx = point.x - points.mX[i];
+    double dy = point.y - points.mY[i];
+    double dz = point.z - points.mZ[i];
+    output[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Computes the dynamic time warping distance between the samples and the reference points. Only
+// cells within a band around the diagonal of the cost matrix are evaluated, so the runtime is
+// linear in the number of samples. Only two rows of the matrix are kept in memory.
+double computeDtwDistance(std::vector<glm::dvec3> const& samples, Points const& reference,
+    std::size_t referenceSize, double bandFraction) {
+
+  std::size_t n = samples.size();
+  std::size_t m = referenceSize;
+
+  // The band has to be at least as wide as the slope of the diagonal, else consecutive rows would
+  // not overlap and there would be no warping path.
+  auto minWidth = static_cast<std::size_t>(std::ceil(static_cast<double>(m) / n)) + 1;
+  auto width    = std::max(minWidth, static_cast<std::size_t>(bandFraction * m));
+
+  double const        infinity = std::numeric_limits<double>::infinity();
+  std::vector<double> previous(m, infinity);
+  std::vector<double> current(m, infinity);
+  std::vector<double> cost(m);
+
+  std::size_t previousBegin = 0;
+  std::size_t previousEnd   = 0;
+
+  for (std::size_t i = 0; i < n; ++i) {
+    std::size_t center = n > 1 ? i * (m - 1) / (n - 1) : m - 1;
+    std::size_t begin  = center > width ? center - width : 0;
+    std::size_t end    = std::min(m, center + width + 1);
+
+    distances(samples[i], reference, begin, end, cost.data());
+
+    for (std::size_t j = begin; j < end; ++j) {
+      double best = infinity;
+
+      if (i == 0 && j == 0) {
+        best = 0.0;
+      } else {
+        best = previous[j];
+        if (j > 0) {
+          best = std::min({best, previous[j - 1], current[j - 1]});
+        }
+      }
+
+      current[j] = cost[j] + best;
+    }
+
+    // The previous row becomes the current one. Reset the cells which were written two rows ago,
+    // so that everything outside the band is infinity.
+    std::swap(previous, current);
+    std::fill(current.begin() + static_cast<std::ptrdiff_t>(previousBegin),
+        current.begin() + static_cast<std::ptrdiff_t>(previousEnd), infinity);
+    previousBegin = begin;
+    previousEnd   = end;
+  }
+
+  return previous[m - 1];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+glm::dvec3 readPosition(nlohmann::json const& location) {
+  auto position = location.find("position");
+
+  if (position == location.end()) {
+    return glm::dvec3(0.0, 0.0, 0.0);
+  }
+
+  return glm::dvec3(position->at(0).get<double>(), position->at(1).get<double>(),
+      position->at(2).get<double>());
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ReferencePath loadReferencePath(std::string const& scenarioFile) {
+  std::ifstream file(scenarioFile);
+
+  if (!file) {
+    throw std::runtime_error("Failed to open scenario file \"" + scenarioFile + "\"!");
+  }
+
+  nlohmann::json scenario;
+
+  try {
+    file >> scenario;
+  } catch (nlohmann::json::exception const& e) {
+    throw std::runtime_error("Failed to parse scenario file \"" + scenarioFile + "\": " + e.what());
+  }
+
+  std::unordered_map<std::string, nlohmann::json> bookmarks;
+
+  if (scenario.contains("bookmarks")) {
+    for (auto const& bookmark : scenario["bookmarks"]) {
+      if (bookmark.contains("name") && bookmark.contains("location")) {
+        bookmarks[bookmark["name"].get<std::string>()] = bookmark["location"];
+      }
+    }
+  }
+
+  if (!scenario.contains("plugins") || !scenario["plugins"].contains("csp-user-study")) {
+    throw std::runtime_error(
+        "Scenario file \"" + scenarioFile + "\" does not contain a user study!");
+  }
+
+  auto const& checkpoints = scenario["plugins"]["csp-user-study"].value(
+      "checkpoints", nlohmann::json::array());
+
+  ReferencePath path;
+
+  for (std::size_t i = 0; i < checkpoints.size(); ++i) {
+    auto const&           checkpoint = checkpoints[i];
+    nlohmann::json const* location   = nullptr;
+
+    if (checkpoint.contains("location")) {
+      location = &checkpoint["location"];
+    } else if (checkpoint.contains("bookmark")) {
+      auto bookmark = bookmarks.find(checkpoint["bookmark"].get<std::string>());
+      if (bookmark != bookmarks.end()) {
+        location = &bookmark->second;
+      }
+    }
+
+    // Checkpoints without a position do not constrain the path of the participant.
+    if (!location || !location->contains("position")) {
+      continue;
+    }
+
+    auto center = location->value("center", std::string());
+    auto frame  = location->value("frame", std::string());
+
+    if (path.mPoints.empty()) {
+      path.mCenter = center;
+      path.mFrame  = frame;
+    } else if (center != path.mCenter || frame != path.mFrame) {
+      continue;
+    }
+
+    path.mPoints.push_back(readPosition(*location));
+    path.mCheckpoints.push_back(static_cast<uint32_t>(i));
+  }
+
+  return path;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PathDeviation analyzeTrajectory(std::vector<TrajectoryBlock> const& trajectory,
+    ReferencePath const& reference, PathDeviationOptions const& options) {
+
+  PathDeviation result;
+
+  if (reference.mPoints.empty()) {
+    return result;
+  }
+
+  // Gather all samples in the frame of the reference path.
+  std::vector<glm::dvec3> positions;
+  std::vector<uint32_t>   checkpoints;
+
+  for (auto const& block : trajectory) {
+    if (block.mCenter != reference.mCenter || block.mFrame != reference.mFrame) {
+      continue;
+    }
+
+    for (auto const& sample : block.mSamples) {
+      positions.push_back(sample.mPosition);
+      checkpoints.push_back(sample.mCheckpoint);
+    }
+  }
+
+  result.mSampleCount = positions.size();
+
+  if (positions.empty()) {
+    return result;
+  }
+
+  // Lateral deviation. Each sample is only compared to the segments around the one leading to its
+  // current checkpoint, so the cost does not grow with the number of checkpoints.
+  Segments segments = makeSegments(reference.mPoints);
+  double   sum      = 0.0;
+  double   sum2     = 0.0;
+
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    std::size_t begin = 0;
+    std::size_t end   = segments.size();
+
+    if (options.mLateralSearchWindow > 0) {
+      auto next = std::lower_bound(
+          reference.mCheckpoints.begin(), reference.mCheckpoints.end(), checkpoints[i]);
+      auto segment = static_cast<std::size_t>(
+          std::max<std::ptrdiff_t>(next - reference.mCheckpoints.begin() - 1, 0));
+
+      begin = segment > options.mLateralSearchWindow ? segment - options.mLateralSearchWindow : 0;
+      end   = std::min(segments.size(), segment + options.mLateralSearchWindow + 1);
+    }
+
+    double d2 = minSquaredDistance(positions[i], segments, begin, end);
+    double d  = std::sqrt(d2);
+
+    sum += d;
+    sum2 += d2;
+    result.mMaxLateralDeviation = std::max(result.mMaxLateralDeviation, d);
+  }
+
+  auto count                   = static_cast<double>(positions.size());
+  result.mMeanLateralDeviation = sum / count;
+  result.mRmsLateralDeviation  = std::sqrt(sum2 / count);
+
+  // Dynamic time warping.
+  auto dtwReference    = resample(reference.mPoints, options.mDtwReferencePoints);
+  result.mDtwDistance = computeDtwDistance(
+      positions, makePoints(dtwReference), dtwReference.size(), options.mDtwBand);
+  result.mMeanDtwDistance = result.mDtwDistance / count;
+
+  // Overshoot at turns. A sample belongs to the turn at point k if the participant has passed the
+  // checkpoint of point k but not yet the one of point k + 1.
+  double const minCosine = std::cos(glm::radians(options.mTurnAngle));
+
+  struct Turn {
+    glm::dvec3 mPoint;
+    glm::dvec3 mIncoming;
+    double     mAllowed   = 0.0;
+    double     mOvershoot = 0.0;
+  };
+
+  std::vector<Turn>                         turns;
+  std::unordered_map<uint32_t, std::size_t> turnForCheckpoint;
+
+  for (std::size_t k = 1; k + 1 < reference.mPoints.size(); ++k) {
+    glm::dvec3 incoming = reference.mPoints[k] - reference.mPoints[k - 1];
+    glm::dvec3 outgoing = reference.mPoints[k + 1] - reference.mPoints[k];
+
+    if (glm::length(incoming) == 0.0 || glm::length(outgoing) == 0.0) {
+      continue;
+    }
+
+    incoming = glm::normalize(incoming);
+
+    if (glm::dot(incoming, glm::normalize(outgoing)) > minCosine) {
+      continue;
+    }
+
+    // The reference path itself may continue in the incoming direction after a turn of less than
+    // ninety degrees. Only the part beyond that counts as overshoot.
+    Turn turn;
+    turn.mPoint    = reference.mPoints[k];
+    turn.mIncoming = incoming;
+    turn.mAllowed  = std::max(0.0, glm::dot(outgoing, incoming));
+
+    for (uint32_t c = reference.mCheckpoints[k] + 1; c <= reference.mCheckpoints[k + 1]; ++c) {
+      turnForCheckpoint[c] = turns.size();
+    }
+
+    turns.push_back(turn);
+  }
+
+  if (!turns.empty()) {
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+      auto turn = turnForCheckpoint.find(checkpoints[i]);
+
+      if (turn != turnForCheckpoint.end()) {
+        auto&  t          = turns[turn->second];
+        double projection = glm::dot(positions[i] - t.mPoint, t.mIncoming) - t.mAllowed;
+        t.mOvershoot      = std::max(t.mOvershoot, projection);
+      }
+    }
+
+    double overshootSum = 0.0;
+
+    for (auto const& turn : turns) {
+      overshootSum += turn.mOvershoot;
+      result.mMaxOvershoot = std::max(result.mMaxOvershoot, turn.mOvershoot);
+    }
+
+    result.mTurnCount     = turns.size();
+    result.mMeanOvershoot = overshootSum / static_cast<double>(turns.size());
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TrajectoryAnalysisResult> analyzeTrajectoryFiles(std::vector<std::string> const& files,
+    ReferencePath const& reference, PathDeviationOptions const& options, std::size_t threadCount) {
+
+  std::vector<TrajectoryAnalysisResult> results(files.size());
+
+  if (threadCount == 0) {
+    threadCount = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  threadCount = std::min(threadCount, files.size());
+
+  // Each worker grabs the next file until all files are done. The files differ in length, so this
+  // balances the load better than a static partitioning.
+  std::atomic<std::size_t> nextFile{0};
+
+  auto worker = [&]() {
+    for (std::size_t i = nextFile++; i < files.size(); i = nextFile++) {
+      auto& result = results[i];
+      result.mFile = files[i];
+
+      try {
+        result.mDeviation = analyzeTrajectory(readTrajectory(files[i]), reference, options);
+      } catch (std::exception const& e) {
+        result.mError = e.what();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+
+  for (std::size_t i = 1; i < threadCount; ++i) {
+    threads.emplace_back(worker);
+  }
+
+  worker();
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  return results;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::userstudy
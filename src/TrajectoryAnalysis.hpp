@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#ifndef CSP_USER_STUDY_TRAJECTORY_ANALYSIS_HPP
+#define CSP_USER_STUDY_TRAJECTORY_ANALYSIS_HPP
+
+#include "TrajectoryCodec.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace csp::userstudy {
+
+/// The path a participant is supposed to follow: the ordered positions of the checkpoints of a
+/// scenario in one reference frame. Checkpoints in other reference frames are not part of the path.
+struct ReferencePath {
+  std::string mCenter;
+  std::string mFrame;
+
+  /// The positions of the checkpoints in meters.
+  std::vector<glm::dvec3> mPoints;
+
+  /// The index of the checkpoint in the scenario for each point.
+  std::vector<uint32_t> mCheckpoints;
+};
+
+/// Parameters for analyzeTrajectory().
+struct PathDeviationOptions {
+
+  /// The lateral deviation of a sample is measured to the segments of the reference path within
+  /// this many segments of the one leading to the sample's current checkpoint. If this is zero,
+  /// all segments are considered.
+  std::size_t mLateralSearchWindow = 16;
+
+  /// The half width of the Sakoe-Chiba band used for dynamic time warping as a fraction of the
+  /// number of reference points.
+  double mDtwBand = 0.1;
+
+  /// Before dynamic time warping, the reference polyline is resampled to this many equally spaced
+  /// points. This way, the result does not depend on the distance between the checkpoints.
+  std::size_t mDtwReferencePoints = 1024;
+
+  /// Checkpoints at which the path changes its direction by more than this angle (in degrees) are
+  /// considered to be turns.
+  double mTurnAngle = 30.0;
+};
+
+/// The deviation of a participant's trajectory from the reference path. All distances are in
+/// meters.
+struct PathDeviation {
+  std::size_t mSampleCount = 0;
+
+  /// The distance of each sample to the closest point on the reference polyline.
+  double mMeanLateralDeviation = 0.0;
+  double mRmsLateralDeviation  = 0.0;
+  double mMaxLateralDeviation  = 0.0;
+
+  /// The dynamic time warping distance between the samples and the reference points. The mean is
+  /// the distance divided by the number of samples.
+  double mDtwDistance     = 0.0;
+  double mMeanDtwDistance = 0.0;
+
+  /// At each turn, the overshoot is how far the participant continued in the incoming direction
+  /// beyond what the reference path does after the turn.
+  std::size_t mTurnCount     = 0;
+  double      mMeanOvershoot = 0.0;
+  double      mMaxOvershoot  = 0.0;
+};
+
+/// The result of analyzing a trajectory file with analyzeTrajectoryFiles().
+struct TrajectoryAnalysisResult {
+  std::string                  mFile;
+  std::optional<PathDeviation> mDeviation;
+
+  /// If the file could not be analyzed, this contains the reason.
+  std::string mError;
+};
+
+/// Reads the reference path from the given scenario file. Checkpoints may either store their
+/// location inline or reference a bookmark of the scene. The reference frame of the first
+/// checkpoint with a position is used. A std::runtime_error is thrown if the file cannot be read.
+ReferencePath loadReferencePath(std::string const& scenarioFile);
+
+/// Computes the deviation of the given trajectory from the reference path. Only samples in the
+/// reference frame of the path are considered.
+PathDeviation analyzeTrajectory(std::vector<TrajectoryBlock> const& trajectory,
+    ReferencePath const& reference, PathDeviationOptions const& options = {});
+
+/// Reads and analyzes all given trajectory files in parallel. If threadCount is zero, one thread
+/// per hardware thread is used. The results are in the same order as the files.
+std::vector<TrajectoryAnalysisResult> analyzeTrajectoryFiles(std::vector<std::string> const& files,
+    ReferencePath const& reference, PathDeviationOptions const& options = {},
+    std::size_t threadCount = 0);
+
+} // namespace csp::userstudy
+
+#endif // CSP_USER_STUDY_TRAJECTORY_ANALYSIS_HPP
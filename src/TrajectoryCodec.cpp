@@ -0,0 +1,568 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#include "TrajectoryCodec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace csp::userstudy {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Each encoded block starts with these four bytes, followed by the size of the block's payload.
+constexpr std::array<char, 4> BLOCK_MAGIC = {'U', 'S', 'T', 'B'};
+
+// The number of pending samples after which the background thread of the TrajectoryWriter is
+// woken up.
+constexpr std::size_t WAKE_UP_THRESHOLD = 128;
+
+// Helpers for writing -----------------------------------------------------------------------------
+
+void writeVarint(std::string& output, uint64_t value) {
+  while (value >= 0x80U) {
+    output.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+    value >>= 7U;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+uint64_t zigzag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1U) ^ static_cast<uint64_t>(value >> 63);
+}
+
+void writeSigned(std::string& output, int64_t value) {
+  writeVarint(output, zigzag(value));
+}
+
+void writeString(std::string& output, std::string const& value) {
+  writeVarint(output, value.size());
+  output.append(value);
+}
+
+uint64_t toBits(double value) {
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double fromBits(uint64_t bits) {
+  double value = 0.0;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Lossless doubles are stored as XOR with the previous value. For slowly changing values, the
+// upper bits (sign, exponent and leading mantissa bits) cancel out and are dropped by the varint
+// encoding. Unchanged values only require a single byte.
+void writeDouble(std::string& output, double value, double previous) {
+  writeVarint(output, toBits(value) ^ toBits(previous));
+}
+
+// Helpers for reading -----------------------------------------------------------------------------
+
+class Reader {
+ public:
+  explicit Reader(std::string_view data)
+      : mData(data) {
+  }
+
+  bool atEnd() const {
+    return mPos >= mData.size();
+  }
+
+  std::size_t remaining() const {
+    return mData.size() - mPos;
+  }
+
+  uint64_t readVarint() {
+    uint64_t result = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+      if (atEnd()) {
+        throw std::runtime_error("Unexpected end of trajectory data!");
+      }
+      auto byte = static_cast<uint8_t>(mData[mPos++]);
+      result |= static_cast<uint64_t>(byte & 0x7FU) << shift;
+      if ((byte & 0x80U) == 0) {
+        return result;
+      }
+    }
+    throw std::runtime_error("Invalid variable-length integer in trajectory data!");
+  }
+
+  int64_t readSigned() {
+    uint64_t value = readVarint();
+    return static_cast<int64_t>(value >> 1U) ^ -static_cast<int64_t>(value & 1U);
+  }
+
+  std::string_view readBytes(std::size_t count) {
+    if (remaining() < count) {
+      throw std::runtime_error("Unexpected end of trajectory data!");
+    }
+    auto result = mData.substr(mPos, count);
+    mPos += count;
+    return result;
+  }
+
+  std::string readString() {
+    return std::string(readBytes(readVarint()));
+  }
+
+  double readDouble(double previous) {
+    return fromBits(readVarint() ^ toBits(previous));
+  }
+
+ private:
+  std::string_view mData;
+  std::size_t      mPos = 0;
+};
+
+// Linear prediction -------------------------------------------------------------------------------
+
+// Predicts the next value of a channel by extrapolating the last two values and returns the
+// difference to the prediction. For the smooth motion of the observer and the regular frame times,
+// these residuals are much smaller than the plain deltas.
+class LinearPredictor {
+ public:
+  int64_t encode(int64_t value) {
+    int64_t residual = value - mPrevious - mDelta;
+    update(value);
+    return residual;
+  }
+
+  int64_t decode(int64_t residual) {
+    int64_t value = mPrevious + mDelta + residual;
+    update(value);
+    return value;
+  }
+
+  void reset() {
+    mPrevious = 0;
+    mDelta    = 0;
+  }
+
+ private:
+  void update(int64_t value) {
+    mDelta    = value - mPrevious;
+    mPrevious = value;
+  }
+
+  int64_t mPrevious = 0;
+  int64_t mDelta    = 0;
+};
+
+// The first value of each sample contains the time residual and these flags in its lowest bits.
+// The checkpoint index and the scale are only stored if they changed.
+constexpr uint64_t CHECKPOINT_CHANGED = 1U;
+constexpr uint64_t SCALE_CHANGED      = 2U;
+constexpr uint32_t FLAG_BITS          = 2U;
+
+// The scale is stored as log2(scale) with the given number of fractional bits.
+int64_t quantizeScale(double scale, uint32_t bits) {
+  double exponent = std::log2(std::max(scale, std::numeric_limits<double>::min()));
+  return std::llround(std::ldexp(exponent, static_cast<int>(bits)));
+}
+
+double dequantizeScale(int64_t value, uint32_t bits) {
+  return std::exp2(std::ldexp(static_cast<double>(value), -static_cast<int>(bits)));
+}
+
+// Smallest-three quaternion encoding --------------------------------------------------------------
+
+// A unit quaternion is stored as the index of its largest component and the three remaining
+// components. As the largest component is positive (q and -q are the same rotation), it can be
+// reconstructed from the other three. These are in the range [-1/sqrt(2), 1/sqrt(2)] and are
+// quantized to the given number of bits.
+struct PackedRotation {
+  uint32_t               mLargest = 0;
+  std::array<int64_t, 3> mComponents{};
+};
+
+PackedRotation packRotation(glm::dquat const& rotation, uint32_t bits) {
+  std::array<double, 4> c = {rotation.w, rotation.x, rotation.y, rotation.z};
+
+  PackedRotation packed;
+  for (uint32_t i = 1; i < 4; ++i) {
+    if (std::abs(c[i]) > std::abs(c[packed.mLargest])) {
+      packed.mLargest = i;
+    }
+  }
+
+  double sign     = c[packed.mLargest] < 0.0 ? -1.0 : 1.0;
+  double maxValue = static_cast<double>((1U << (bits - 1U)) - 1U);
+
+  for (uint32_t i = 0, j = 0; i < 4; ++i) {
+    if (i != packed.mLargest) {
+      double normalized     = std::clamp(sign * c[i] * std::sqrt(2.0), -1.0, 1.0);
+      packed.mComponents[j] = std::llround(normalized * maxValue);
+      ++j;
+    }
+  }
+
+  return packed;
+}
+
+glm::dquat unpackRotation(PackedRotation const& packed, uint32_t bits) {
+  double maxValue = static_cast<double>((1U << (bits - 1U)) - 1U);
+
+  std::array<double, 4> c{};
+  double                sum = 0.0;
+
+  for (uint32_t i = 0, j = 0; i < 4; ++i) {
+    if (i != packed.mLargest) {
+      c[i] = static_cast<double>(packed.mComponents[j]) / maxValue / std::sqrt(2.0);
+      sum += c[i] * c[i];
+      ++j;
+    }
+  }
+
+  c[packed.mLargest] = std::sqrt(std::max(0.0, 1.0 - sum));
+
+  return glm::normalize(glm::dquat(c[0], c[1], c[2], c[3]));
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void encodeTrajectoryBlock(TrajectoryBlock const& block,
+    TrajectoryQuantization const& quantization, std::string& output) {
+
+  double   precision = std::max(quantization.mPositionPrecision, 0.0);
+  uint32_t bits      = quantization.mRotationBits == 0
+                           ? 0
+                           : std::clamp(quantization.mRotationBits, uint32_t(2), uint32_t(30));
+  uint32_t scaleBits = std::min(quantization.mScaleBits, uint32_t(30));
+
+  std::string payload;
+  payload.reserve(8 * block.mSamples.size() + 64);
+
+  // The block header contains everything which is required for decoding the block.
+  writeString(payload, block.mCenter);
+  writeString(payload, block.mFrame);
+  writeVarint(payload, toBits(precision));
+  writeVarint(payload, bits);
+  writeVarint(payload, scaleBits);
+  writeVarint(payload, block.mSamples.size());
+
+  TrajectorySample               previous;
+  int64_t                        previousScale = 0;
+  LinearPredictor                time;
+  std::array<LinearPredictor, 3> position;
+  std::array<LinearPredictor, 3> rotation;
+  uint32_t                       previousLargest = 0;
+
+  for (auto const& sample : block.mSamples) {
+    int64_t scale        = scaleBits > 0 ? quantizeScale(sample.mScale, scaleBits) : 0;
+    bool    scaleChanged = scaleBits > 0 ? scale != previousScale
+                                         : toBits(sample.mScale) != toBits(previous.mScale);
+
+    uint64_t flags = (sample.mCheckpoint != previous.mCheckpoint ? CHECKPOINT_CHANGED : 0U) |
+                     (scaleChanged ? SCALE_CHANGED : 0U);
+
+    writeVarint(payload, (zigzag(time.encode(sample.mTime)) << FLAG_BITS) | flags);
+
+    if (flags & CHECKPOINT_CHANGED) {
+      writeSigned(payload, static_cast<int64_t>(sample.mCheckpoint) -
+                               static_cast<int64_t>(previous.mCheckpoint));
+    }
+
+    if (precision > 0.0) {
+      for (int i = 0; i < 3; ++i) {
+        writeSigned(payload, position[i].encode(std::llround(sample.mPosition[i] / precision)));
+      }
+    } else {
+      for (int i = 0; i < 3; ++i) {
+        writeDouble(payload, sample.mPosition[i], previous.mPosition[i]);
+      }
+    }
+
+    if (bits > 0) {
+      PackedRotation packed = packRotation(sample.mRotation, bits);
+
+      // The index of the largest component is stored in the two lowest bits of the first residual.
+      // If it changed, the components are stored without prediction.
+      if (packed.mLargest != previousLargest) {
+        for (auto& predictor : rotation) {
+          predictor.reset();
+        }
+      }
+
+      writeVarint(payload,
+          (zigzag(rotation[0].encode(packed.mComponents[0])) << 2U) | packed.mLargest);
+      writeSigned(payload, rotation[1].encode(packed.mComponents[1]));
+      writeSigned(payload, rotation[2].encode(packed.mComponents[2]));
+
+      previousLargest = packed.mLargest;
+    } else {
+      writeDouble(payload, sample.mRotation.w, previous.mRotation.w);
+      writeDouble(payload, sample.mRotation.x, previous.mRotation.x);
+      writeDouble(payload, sample.mRotation.y, previous.mRotation.y);
+      writeDouble(payload, sample.mRotation.z, previous.mRotation.z);
+    }
+
+    if (flags & SCALE_CHANGED) {
+      if (scaleBits > 0) {
+        writeSigned(payload, scale - previousScale);
+      } else {
+        writeDouble(payload, sample.mScale, previous.mScale);
+      }
+    }
+
+    previous      = sample;
+    previousScale = scale;
+  }
+
+  output.append(BLOCK_MAGIC.data(), BLOCK_MAGIC.size());
+  writeVarint(output, payload.size());
+  output.append(payload);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TrajectoryBlock> decodeTrajectory(std::string_view data) {
+  std::vector<TrajectoryBlock> blocks;
+  Reader                       file(data);
+
+  while (!file.atEnd()) {
+
+    // A block which has not been written completely is ignored.
+    if (file.remaining() < BLOCK_MAGIC.size()) {
+      break;
+    }
+
+    auto magic = file.readBytes(BLOCK_MAGIC.size());
+    if (magic != std::string_view(BLOCK_MAGIC.data(), BLOCK_MAGIC.size())) {
+      throw std::runtime_error("Invalid block header in trajectory data!");
+    }
+
+    std::string_view payload;
+    try {
+      payload = file.readBytes(file.readVarint());
+    } catch (std::runtime_error const&) {
+      break;
+    }
+
+    Reader          reader(payload);
+    TrajectoryBlock block;
+
+    block.mCenter      = reader.readString();
+    block.mFrame       = reader.readString();
+    double   precision = fromBits(reader.readVarint());
+    auto     bits      = static_cast<uint32_t>(reader.readVarint());
+    auto     scaleBits = static_cast<uint32_t>(reader.readVarint());
+    uint64_t count     = reader.readVarint();
+
+    if (bits == 1 || bits > 30 || scaleBits > 30) {
+      throw std::runtime_error("Invalid quantization in trajectory data!");
+    }
+
+    // Each sample requires at least one byte per field, so this protects against huge allocations
+    // for corrupt data.
+    block.mSamples.reserve(std::min<uint64_t>(count, payload.size()));
+
+    TrajectorySample               previous;
+    int64_t                        previousScale = 0;
+    LinearPredictor                time;
+    std::array<LinearPredictor, 3> position;
+    std::array<LinearPredictor, 3> rotation;
+    uint32_t                       previousLargest = 0;
+
+    for (uint64_t s = 0; s < count; ++s) {
+      TrajectorySample sample;
+
+      uint64_t first    = reader.readVarint();
+      uint64_t flags    = first & ((1U << FLAG_BITS) - 1U);
+      uint64_t residual = first >> FLAG_BITS;
+      sample.mTime =
+          time.decode(static_cast<int64_t>(residual >> 1U) ^ -static_cast<int64_t>(residual & 1U));
+
+      sample.mCheckpoint = previous.mCheckpoint;
+      if (flags & CHECKPOINT_CHANGED) {
+        sample.mCheckpoint = static_cast<uint32_t>(
+            static_cast<int64_t>(previous.mCheckpoint) + reader.readSigned());
+      }
+
+      if (precision > 0.0) {
+        for (int i = 0; i < 3; ++i) {
+          sample.mPosition[i] =
+              static_cast<double>(position[i].decode(reader.readSigned())) * precision;
+        }
+      } else {
+        for (int i = 0; i < 3; ++i) {
+          sample.mPosition[i] = reader.readDouble(previous.mPosition[i]);
+        }
+      }
+
+      if (bits > 0) {
+        uint64_t       packedFirst = reader.readVarint();
+        PackedRotation packed;
+        packed.mLargest = static_cast<uint32_t>(packedFirst & 3U);
+
+        if (packed.mLargest != previousLargest) {
+          for (auto& predictor : rotation) {
+            predictor.reset();
+          }
+        }
+
+        uint64_t delta        = packedFirst >> 2U;
+        packed.mComponents[0] = rotation[0].decode(
+            static_cast<int64_t>(delta >> 1U) ^ -static_cast<int64_t>(delta & 1U));
+        packed.mComponents[1] = rotation[1].decode(reader.readSigned());
+        packed.mComponents[2] = rotation[2].decode(reader.readSigned());
+
+        sample.mRotation = unpackRotation(packed, bits);
+        previousLargest  = packed.mLargest;
+      } else {
+        sample.mRotation.w = reader.readDouble(previous.mRotation.w);
+        sample.mRotation.x = reader.readDouble(previous.mRotation.x);
+        sample.mRotation.y = reader.readDouble(previous.mRotation.y);
+        sample.mRotation.z = reader.readDouble(previous.mRotation.z);
+      }
+
+      sample.mScale = previous.mScale;
+      if (flags & SCALE_CHANGED) {
+        if (scaleBits > 0) {
+          previousScale += reader.readSigned();
+          sample.mScale = dequantizeScale(previousScale, scaleBits);
+        } else {
+          sample.mScale = reader.readDouble(previous.mScale);
+        }
+      }
+
+      block.mSamples.push_back(sample);
+      previous = sample;
+    }
+
+    blocks.push_back(std::move(block));
+  }
+
+  return blocks;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TrajectoryBlock> readTrajectory(std::string const& fileName) {
+  std::ifstream file(fileName, std::ios::binary);
+
+  if (!file) {
+    throw std::runtime_error("Failed to open trajectory file \"" + fileName + "\"!");
+  }
+
+  std::stringstream content;
+  content << file.rdbuf();
+
+  return decodeTrajectory(content.str());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TrajectoryWriter::TrajectoryWriter(
+    std::string fileName, TrajectoryQuantization quantization, std::size_t blockSize)
+    : mFileName(std::move(fileName))
+    , mQuantization(quantization)
+    , mBlockSize(std::max<std::size_t>(blockSize, 1))
+    , mThread(&TrajectoryWriter::run, this) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TrajectoryWriter::~TrajectoryWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+
+  mCondition.notify_one();
+  mThread.join();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TrajectoryWriter::push(
+    std::string const& center, std::string const& frame, TrajectorySample const& sample) {
+
+  bool wakeUp = false;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPending.push_back({center, frame, sample});
+    wakeUp = mPending.size() >= WAKE_UP_THRESHOLD;
+  }
+
+  if (wakeUp) {
+    mCondition.notify_one();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TrajectoryWriter::run() {
+  std::vector<Entry> entries;
+
+  while (true) {
+    bool stop = false;
+
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCondition.wait(lock, [this]() { return mStop || mPending.size() >= WAKE_UP_THRESHOLD; });
+      std::swap(entries, mPending);
+      stop = mStop;
+    }
+
+    for (auto const& entry : entries) {
+      if (entry.mCenter != mBlock.mCenter || entry.mFrame != mBlock.mFrame) {
+        writeBlock();
+        mBlock.mCenter = entry.mCenter;
+        mBlock.mFrame  = entry.mFrame;
+      }
+
+      mBlock.mSamples.push_back(entry.mSample);
+
+      if (mBlock.mSamples.size() >= mBlockSize) {
+        writeBlock();
+      }
+    }
+
+    entries.clear();
+
+    if (stop) {
+      writeBlock();
+      return;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TrajectoryWriter::writeBlock() {
+  if (mBlock.mSamples.empty()) {
+    return;
+  }
+
+  if (!mFile.is_open()) {
+    mFile.open(mFileName, std::ios::binary | std::ios::app);
+  }
+
+  mBuffer.clear();
+  encodeTrajectoryBlock(mBlock, mQuantization, mBuffer);
+  mFile.write(mBuffer.data(), static_cast<std::streamsize>(mBuffer.size()));
+  mFile.flush();
+
+  mBlock.mSamples.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::userstudy
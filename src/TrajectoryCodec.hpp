@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#ifndef CSP_USER_STUDY_TRAJECTORY_CODEC_HPP
+#define CSP_USER_STUDY_TRAJECTORY_CODEC_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace csp::userstudy {
+
+/// A single pose of the observer during a user study.
+struct TrajectorySample {
+
+  /// Microseconds since the start of the recording.
+  int64_t mTime = 0;
+
+  /// The index of the checkpoint which was active when this sample was taken.
+  uint32_t mCheckpoint = 0;
+
+  /// The observer's pose relative to the SPICE frame of the enclosing TrajectoryBlock.
+  glm::dvec3 mPosition{0.0, 0.0, 0.0};
+  glm::dquat mRotation{1.0, 0.0, 0.0, 0.0};
+  double     mScale = 1.0;
+};
+
+/// A sequence of samples in the same SPICE frame. Each block is encoded independently, so a
+/// trajectory file can be decoded even if it has been truncated.
+struct TrajectoryBlock {
+  std::string                   mCenter;
+  std::string                   mFrame;
+  std::vector<TrajectorySample> mSamples;
+};
+
+/// Parameters for the lossy encoding of positions, rotations and the scale. A value of zero stores
+/// the respective field losslessly. Time and checkpoint index are always stored losslessly.
+struct TrajectoryQuantization {
+
+  /// Positions are rounded to multiples of this value (in meters).
+  double mPositionPrecision = 0.001;
+
+  /// Rotations are stored with the smallest-three encoding. This is the number of bits of each of
+  /// the three stored components. It is clamped to the range [2, 30].
+  uint32_t mRotationBits = 16;
+
+  /// The scale is stored as log2(scale) with this many fractional bits. Its relative error is
+  /// below 2^-(bits+1). The value is clamped to the range [0, 30].
+  uint32_t mScaleBits = 16;
+};
+
+/// Encodes the given block and appends it to the output. Time, position and rotation are predicted
+/// linearly from the two previous samples; only the residuals are stored as variable-length
+/// integers. The checkpoint index and the scale are only stored if they changed.
+void encodeTrajectoryBlock(TrajectoryBlock const& block,
+    TrajectoryQuantization const& quantization, std::string& output);
+
+/// Decodes all blocks of the given data. A std::runtime_error is thrown if the data is malformed.
+/// An incomplete block at the end of the data is ignored.
+std::vector<TrajectoryBlock> decodeTrajectory(std::string_view data);
+
+/// Reads the given file and decodes all blocks in it. A std::runtime_error is thrown if the file
+/// cannot be read or is malformed.
+std::vector<TrajectoryBlock> readTrajectory(std::string const& fileName);
+
+/// Collects samples in blocks and writes them encoded to a file. The encoding and the disk access
+/// happen on a background thread, so push() can be called once per frame. The file is only
+/// created once the first block is written. All pending samples are written when the writer is
+/// destroyed.
+class TrajectoryWriter {
+ public:
+  TrajectoryWriter(
+      std::string fileName, TrajectoryQuantization quantization, std::size_t blockSize = 1024);
+  ~TrajectoryWriter();
+
+  TrajectoryWriter(TrajectoryWriter const& other) = delete;
+  TrajectoryWriter(TrajectoryWriter&& other)      = delete;
+
+  TrajectoryWriter& operator=(TrajectoryWriter const& other) = delete;
+  TrajectoryWriter& operator=(TrajectoryWriter&& other) = delete;
+
+  /// Adds a sample given relative to the given SPICE frame. A new block is started whenever the
+  /// frame changes.
+  void push(std::string const& center, std::string const& frame, TrajectorySample const& sample);
+
+ private:
+  struct Entry {
+    std::string      mCenter;
+    std::string      mFrame;
+    TrajectorySample mSample;
+  };
+
+  void run();
+  void writeBlock();
+
+  std::string            mFileName;
+  TrajectoryQuantization mQuantization;
+  std::size_t            mBlockSize;
+
+  // These are only accessed by the background thread.
+  std::ofstream   mFile;
+  TrajectoryBlock mBlock;
+  std::string     mBuffer;
+
+  // These are shared between push() and the background thread.
+  std::mutex              mMutex;
+  std::condition_variable mCondition;
+  std::vector<Entry>      mPending;
+  bool                    mStop = false;
+
+  std::thread mThread;
+};
+
+} // namespace csp::userstudy
+
+#endif // CSP_USER_STUDY_TRAJECTORY_CODEC_HPP
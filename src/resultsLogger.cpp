@@ -17,24 +17,34 @@ namespace csp::userstudy {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-spdlog::logger& resultsLogger() {
-  // Get current date
-  time_t     rawtime  = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-  struct tm* timeinfo = nullptr;
-  char       buffer[80];
+std::string const& getSessionTimestamp() {
+  static std::string timestamp = []() {
+    // Get current date
+    time_t     rawtime  = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    struct tm* timeinfo = nullptr;
+    char       buffer[80];
+
+    time(&rawtime);
 
-  time(&rawtime);
+    // Disables a warning in MSVC about using localtime_s, which isn't supported in GCC.
+    CS_WARNINGS_PUSH
+    CS_DISABLE_MSVC_WARNING(4996)
 
-  // Disables a warning in MSVC about using localtime_s, which isn't supported in GCC.
-  CS_WARNINGS_PUSH
-  CS_DISABLE_MSVC_WARNING(4996)
+    timeinfo = localtime(&rawtime);
 
-  timeinfo = localtime(&rawtime);
+    CS_WARNINGS_POP
 
-  CS_WARNINGS_POP
+    strftime(buffer, sizeof(buffer), "%d-%m-%Y_%H-%M-%S", timeinfo);
+    return std::string(buffer);
+  }();
+
+  return timestamp;
+}
 
-  strftime(buffer, sizeof(buffer), "%d-%m-%Y_%H-%M-%S", timeinfo);
-  std::string date(buffer);
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+spdlog::logger& resultsLogger() {
+  std::string const& date = getSessionTimestamp();
 
   // create sink with date in filename
   // TODO: uncomment date
@@ -16,6 +16,11 @@ namespace csp::userstudy {
 /// and returns it. See cs-utils/logger.hpp for more logging details.
 spdlog::logger& resultsLogger();
 
+/// Returns the date and time at which this function has been called for the first time. This is
+/// used as a prefix for all files written during a session, so that they can be associated with
+/// each other.
+std::string const& getSessionTimestamp();
+
 } // namespace csp::userstudy
 
 #endif // CSP_USER_STUDY_RESULTSLOGGER_HPP
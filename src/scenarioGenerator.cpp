@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#include "scenarioGenerator.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+#include <random>
+
+namespace csp::userstudy {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void generateScenario(ScenarioGeneratorOptions const& options, Plugin::Settings& settings,
+    std::vector<cs::core::Settings::Bookmark>& bookmarks) {
+
+  using Type = Plugin::Settings::Checkpoint::Type;
+
+  std::mt19937                           generator(options.mSeed);
+  std::uniform_real_distribution<double> random(0.0, 1.0);
+
+  settings.mCheckpoints.clear();
+  settings.mCheckpoints.reserve(options.mCheckpointCount);
+
+  std::size_t frameCount      = std::max<std::size_t>(options.mFrames.size(), 1);
+  std::size_t sectionLength   = std::max<std::size_t>(options.mCheckpointCount / frameCount, 1);
+  double      angleStep       = options.mSpacing / options.mRadius;
+  double      heightPerRadian = options.mSpacing / (2.0 * glm::pi<double>());
+
+  for (std::size_t i = 0; i < options.mCheckpointCount; ++i) {
+    Plugin::Settings::Checkpoint checkpoint;
+    checkpoint.mScaling = 1.F;
+
+    // Mix the checkpoint types in roughly the same ratios as they occur in real scenarios.
+    if (i + 1 == options.mCheckpointCount) {
+      checkpoint.mType = Type::eSwitchScenario;
+    } else if (i % 10 == 9) {
+      checkpoint.mType = Type::eRequestFMS;
+    } else if (i % 100 == 50) {
+      checkpoint.mType = Type::eRequestCOG;
+    } else if (i % 100 == 0) {
+      checkpoint.mType = Type::eMessage;
+      checkpoint.mData = "Please fly through the next rings.";
+    }
+
+    // Each section of the path is a helix around the center of its frame.
+    std::size_t section = std::min(i / sectionLength, frameCount - 1);
+    double      angle   = static_cast<double>(i) * angleStep;
+
+    glm::dvec3 position(options.mRadius * std::cos(angle), options.mRadius * std::sin(angle),
+        heightPerRadian * angle);
+    glm::dvec3 direction(-std::sin(angle), std::cos(angle), 0.0);
+
+    cs::core::Settings::Bookmark::Location location;
+    if (!options.mFrames.empty()) {
+      location.mCenter = options.mFrames[section].first;
+      location.mFrame  = options.mFrames[section].second;
+    }
+    location.mPosition = position;
+    location.mRotation = glm::quatLookAt(direction, glm::dvec3(0.0, 0.0, 1.0));
+
+    if (random(generator) < options.mBookmarkRatio) {
+      cs::core::Settings::Bookmark bookmark;
+      bookmark.mName     = "user-study-bookmark-" + std::to_string(i);
+      bookmark.mLocation = location;
+      bookmarks.push_back(bookmark);
+
+      checkpoint.mBookmarkName = bookmark.mName;
+    } else {
+      checkpoint.mLocation = location;
+    }
+
+    settings.mCheckpoints.push_back(checkpoint);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::userstudy
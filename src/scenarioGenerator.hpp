@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#ifndef CSP_USER_STUDY_SCENARIO_GENERATOR_HPP
+#define CSP_USER_STUDY_SCENARIO_GENERATOR_HPP
+
+#include "Plugin.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace csp::userstudy {
+
+/// The parameters for generateScenario().
+struct ScenarioGeneratorOptions {
+
+  /// The total number of checkpoints to create.
+  std::size_t mCheckpointCount = 1000;
+
+  /// The path is split into consecutive sections, one for each entry of this list. Each pair
+  /// contains the SPICE center and frame name of a section.
+  std::vector<std::pair<std::string, std::string>> mFrames = {{"Earth", "IAU_Earth"}};
+
+  /// The generated path is a helix around the center of each section. This is the radius of the
+  /// helix in meters.
+  double mRadius = 7000000.0;
+
+  /// The distance between two consecutive checkpoints in meters.
+  double mSpacing = 10000.0;
+
+  /// The fraction of checkpoints which reference a bookmark instead of storing their pose inline.
+  double mBookmarkRatio = 0.0;
+
+  /// Used for choosing the checkpoint types and the bookmark-based checkpoints.
+  uint32_t mSeed = 0;
+};
+
+/// Creates a synthetic but valid scenario for the user-study plugin. The checkpoints of the given
+/// settings are replaced. The checkpoint types are mixed: most are simple checkpoints, every tenth
+/// requests an FMS rating and there are occasional COG measurements and messages. The last
+/// checkpoint allows switching the scenario. For all checkpoints which reference a bookmark, a
+/// corresponding bookmark is appended to the given list.
+void generateScenario(ScenarioGeneratorOptions const& options, Plugin::Settings& settings,
+    std::vector<cs::core::Settings::Bookmark>& bookmarks);
+
+} // namespace csp::userstudy
+
+#endif // CSP_USER_STUDY_SCENARIO_GENERATOR_HPP
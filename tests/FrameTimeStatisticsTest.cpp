@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#include "../src/FrameTimeStatistics.hpp"
+
+#include <doctest.h>
+
+#include <algorithm>
+#include <random>
+
+namespace csp::userstudy {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::userstudy::computeFrameTimeStatistics - percentiles use the nearest rank") {
+  std::vector<float> frameTimes;
+  for (int i = 1; i <= 100; ++i) {
+    frameTimes.push_back(static_cast<float>(i));
+  }
+
+  std::shuffle(frameTimes.begin(), frameTimes.end(), std::mt19937(1));
+
+  auto statistics = computeFrameTimeStatistics(frameTimes, 90.F);
+
+  CHECK(statistics.mFrameCount == 100);
+  CHECK(statistics.mMedian == 50.F);
+  CHECK(statistics.mP95 == 95.F);
+  CHECK(statistics.mP99 == 99.F);
+  CHECK(statistics.mMax == 100.F);
+  CHECK(statistics.mOverBudget == 10);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::userstudy::computeFrameTimeStatistics - single hitches show up in the p99") {
+  // With fewer than 100 frames, the 99th percentile is the longest frame.
+  std::vector<float> frameTimes(49, 11.F);
+  frameTimes.push_back(48.F);
+
+  auto statistics = computeFrameTimeStatistics(frameTimes, 11.1F);
+
+  CHECK(statistics.mMedian == 11.F);
+  CHECK(statistics.mP95 == 11.F);
+  CHECK(statistics.mP99 == 48.F);
+  CHECK(statistics.mOverBudget == 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::userstudy::computeFrameTimeStatistics - empty and single-frame segments") {
+  std::vector<float> frameTimes;
+  CHECK(computeFrameTimeStatistics(frameTimes, 11.1F).mFrameCount == 0);
+
+  frameTimes.push_back(12.F);
+  auto statistics = computeFrameTimeStatistics(frameTimes, 11.1F);
+
+  CHECK(statistics.mMedian == 12.F);
+  CHECK(statistics.mP99 == 12.F);
+  CHECK(statistics.mMax == 12.F);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::userstudy
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#include "../src/SpatialIndex.hpp"
+
+#include <doctest.h>
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace csp::userstudy {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Returns the position of checkpoint i of a path which circles the origin several times. Each lap
+// consists of the given number of checkpoints and is slightly larger than the previous one.
+glm::dvec3 getLoopPosition(std::size_t i, std::size_t checkpointsPerLap) {
+  double lap   = static_cast<double>(i / checkpointsPerLap);
+  double angle = 2.0 * glm::pi<double>() * static_cast<double>(i % checkpointsPerLap) /
+                 static_cast<double>(checkpointsPerLap);
+  double r     = 1000.0 + lap * 5.0;
+  return glm::dvec3(r * std::cos(angle), r * std::sin(angle), 0.0);
+}
+
+// Finds the closest point with an index in [minIndex, maxIndex] by testing all of them.
+std::optional<SpatialIndex::Result> findNearest(std::vector<glm::dvec3> const& points,
+    glm::dvec3 const& position, uint32_t minIndex, uint32_t maxIndex) {
+
+  std::optional<SpatialIndex::Result> best;
+
+  for (uint32_t i = minIndex; i <= maxIndex && i < points.size(); ++i) {
+    double distance = glm::length(points[i] - position);
+    if (!best || distance < best->mDistance) {
+      best = SpatialIndex::Result{i, distance};
+    }
+  }
+
+  return best;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::userstudy::SpatialIndex - looped paths only resync within the window") {
+  const std::size_t checkpointsPerLap = 100;
+  const std::size_t lapCount          = 3;
+
+  SpatialIndex index;
+  for (std::size_t i = 0; i < checkpointsPerLap * lapCount; ++i) {
+    index.add(getLoopPosition(i, checkpointsPerLap), static_cast<uint32_t>(i));
+  }
+  index.build();
+
+  // The participant is at checkpoint 10 of the first lap and has missed the next two rings. The
+  // position is slightly outside the first lap, so checkpoint 112 of the second lap is closer than
+  // checkpoint 12.
+  glm::dvec3 observer = getLoopPosition(12, checkpointsPerLap) * 1.004;
+
+  auto global = index.nearest(observer);
+  REQUIRE(global);
+  CHECK(global->mIndex == 112);
+
+  auto windowed = index.nearest(observer, 11, 20);
+  REQUIRE(windowed);
+  CHECK(windowed->mIndex == 12);
+  CHECK(windowed->mDistance > global->mDistance);
+
+  // At the end of the path, the window may be empty.
+  CHECK(!index.nearest(observer, 300, 310));
+  CHECK(!index.nearest(observer, 20, 11));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::userstudy::SpatialIndex - windowed queries match a linear search") {
+  std::mt19937                           generator(1);
+  std::uniform_real_distribution<double> coordinate(-1000.0, 1000.0);
+  std::uniform_int_distribution<int>     start(0, 2100);
+  std::uniform_int_distribution<int>     length(0, 40);
+
+  std::vector<glm::dvec3> points;
+  SpatialIndex            index;
+
+  for (uint32_t i = 0; i < 2000; ++i) {
+    points.emplace_back(coordinate(generator), coordinate(generator), coordinate(generator));
+    index.add(points.back(), i);
+  }
+  index.build();
+
+  for (int i = 0; i < 1000; ++i) {
+    glm::dvec3 position(coordinate(generator), coordinate(generator), coordinate(generator));
+    auto       minIndex = static_cast<uint32_t>(start(generator));
+    auto       maxIndex = minIndex + static_cast<uint32_t>(length(generator));
+
+    auto expected = findNearest(points, position, minIndex, maxIndex);
+    auto actual   = index.nearest(position, minIndex, maxIndex);
+
+    REQUIRE(expected.has_value() == actual.has_value());
+    if (expected) {
+      CHECK(actual->mIndex == expected->mIndex);
+      CHECK(actual->mDistance == doctest::Approx(expected->mDistance));
+    }
+  }
+
+  // Without a window, the closest of all points is returned.
+  for (int i = 0; i < 100; ++i) {
+    glm::dvec3 position(coordinate(generator), coordinate(generator), coordinate(generator));
+    auto       expected = findNearest(points, position, 0, std::numeric_limits<uint32_t>::max());
+    auto       actual   = index.nearest(position);
+
+    REQUIRE(actual);
+    CHECK(actual->mIndex == expected->mIndex);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::userstudy
@@ -0,0 +1,193 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#include "../src/TrajectoryAnalysis.hpp"
+
+#include <doctest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace csp::userstudy {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Creates a zig-zag path. All segments have the same length, so resampling the path to as many
+// points as it has checkpoints yields the checkpoints again.
+ReferencePath createPath(std::size_t checkpointCount) {
+  ReferencePath path;
+  path.mCenter = "Earth";
+  path.mFrame  = "IAU_Earth";
+
+  for (std::size_t i = 0; i < checkpointCount; ++i) {
+    path.mPoints.emplace_back(
+        static_cast<double>(i) * 100.0, static_cast<double>(i % 2) * 100.0, 0.0);
+    path.mCheckpoints.push_back(static_cast<uint32_t>(i));
+  }
+
+  return path;
+}
+
+// Creates a trajectory which follows the given path with some noise. On each segment, the current
+// checkpoint is the one at its end. The participant hovers at the start for the given number of
+// samples.
+TrajectoryBlock createFlight(ReferencePath const& path, std::size_t samplesPerSegment,
+    std::size_t hoverSamples, double noise) {
+
+  std::mt19937                     generator(1);
+  std::normal_distribution<double> normal(0.0, noise);
+
+  TrajectoryBlock block;
+  block.mCenter = path.mCenter;
+  block.mFrame  = path.mFrame;
+
+  auto addSample = [&](glm::dvec3 const& position, uint32_t checkpoint) {
+    TrajectorySample sample;
+    sample.mTime       = static_cast<int64_t>(block.mSamples.size()) * 11111;
+    sample.mCheckpoint = checkpoint;
+    sample.mPosition =
+        position + glm::dvec3(normal(generator), normal(generator), normal(generator));
+    block.mSamples.push_back(sample);
+  };
+
+  for (std::size_t i = 0; i < hoverSamples; ++i) {
+    addSample(path.mPoints[0], 1);
+  }
+
+  for (std::size_t k = 0; k + 1 < path.mPoints.size(); ++k) {
+    for (std::size_t i = 0; i < samplesPerSegment; ++i) {
+      double t = static_cast<double>(i) / static_cast<double>(samplesPerSegment);
+      addSample(path.mPoints[k] + (path.mPoints[k + 1] - path.mPoints[k]) * t,
+          path.mCheckpoints[k + 1]);
+    }
+  }
+
+  return block;
+}
+
+// Returns the distance of the point to the closest segment of the path.
+double getLateralDeviation(glm::dvec3 const& point, std::vector<glm::dvec3> const& path) {
+  double best = std::numeric_limits<double>::max();
+
+  for (std::size_t k = 0; k + 1 < path.size(); ++k) {
+    glm::dvec3 direction = path[k + 1] - path[k];
+    double     t         = glm::dot(point - path[k], direction) / glm::dot(direction, direction);
+    glm::dvec3 closest   = path[k] + direction * std::clamp(t, 0.0, 1.0);
+    best                 = std::min(best, glm::length(point - closest));
+  }
+
+  return best;
+}
+
+// The textbook dynamic time warping with the full cost matrix.
+double getDtwDistance(std::vector<glm::dvec3> const& a, std::vector<glm::dvec3> const& b) {
+  double const                     infinity = std::numeric_limits<double>::infinity();
+  std::vector<std::vector<double>> cost(a.size() + 1, std::vector<double>(b.size() + 1, infinity));
+  cost[0][0] = 0.0;
+
+  for (std::size_t i = 1; i <= a.size(); ++i) {
+    for (std::size_t j = 1; j <= b.size(); ++j) {
+      cost[i][j] = glm::length(a[i - 1] - b[j - 1]) +
+                   std::min({cost[i - 1][j], cost[i - 1][j - 1], cost[i][j - 1]});
+    }
+  }
+
+  return cost[a.size()][b.size()];
+}
+
+std::vector<glm::dvec3> getPositions(TrajectoryBlock const& block) {
+  std::vector<glm::dvec3> positions;
+  for (auto const& sample : block.mSamples) {
+    positions.push_back(sample.mPosition);
+  }
+  return positions;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::userstudy::analyzeTrajectory - windowed lateral search matches the full one") {
+  auto path   = createPath(200);
+  auto flight = createFlight(path, 10, 0, 5.0);
+
+  PathDeviationOptions windowed;
+  PathDeviationOptions full;
+  full.mLateralSearchWindow = 0;
+
+  auto windowedResult = analyzeTrajectory({flight}, path, windowed);
+  auto fullResult     = analyzeTrajectory({flight}, path, full);
+
+  CHECK(windowedResult.mSampleCount == flight.mSamples.size());
+  CHECK(windowedResult.mMeanLateralDeviation == doctest::Approx(fullResult.mMeanLateralDeviation));
+  CHECK(windowedResult.mRmsLateralDeviation == doctest::Approx(fullResult.mRmsLateralDeviation));
+  CHECK(windowedResult.mMaxLateralDeviation == doctest::Approx(fullResult.mMaxLateralDeviation));
+
+  // The full search is compared to a straightforward implementation.
+  double sum = 0.0;
+  double max = 0.0;
+
+  for (auto const& sample : flight.mSamples) {
+    double d = getLateralDeviation(sample.mPosition, path.mPoints);
+    sum += d;
+    max = std::max(max, d);
+  }
+
+  auto count = static_cast<double>(flight.mSamples.size());
+  CHECK(fullResult.mMeanLateralDeviation == doctest::Approx(sum / count));
+  CHECK(fullResult.mMaxLateralDeviation == doctest::Approx(max));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::userstudy::analyzeTrajectory - full DTW matches the textbook algorithm") {
+  auto path   = createPath(40);
+  auto flight = createFlight(path, 20, 100, 5.0);
+
+  // A band of one covers the whole cost matrix. As all segments have the same length, the
+  // resampled reference path consists of the checkpoints.
+  PathDeviationOptions options;
+  options.mDtwBand            = 1.0;
+  options.mDtwReferencePoints = path.mPoints.size();
+
+  auto result   = analyzeTrajectory({flight}, path, options);
+  auto expected = getDtwDistance(getPositions(flight), path.mPoints);
+
+  CHECK(result.mDtwDistance == doctest::Approx(expected));
+  CHECK(result.mMeanDtwDistance ==
+        doctest::Approx(expected / static_cast<double>(flight.mSamples.size())));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::userstudy::analyzeTrajectory - banded DTW matches full DTW near the diagonal") {
+  auto path = createPath(40);
+
+  PathDeviationOptions banded;
+  banded.mDtwReferencePoints = path.mPoints.size();
+
+  PathDeviationOptions full = banded;
+  full.mDtwBand             = 1.0;
+
+  // If the participant progresses uniformly, the optimal warping path stays within the band.
+  auto uniform = createFlight(path, 20, 0, 5.0);
+  CHECK(analyzeTrajectory({uniform}, path, banded).mDtwDistance ==
+        doctest::Approx(analyzeTrajectory({uniform}, path, full).mDtwDistance));
+
+  // Otherwise, the band can only make the distance larger.
+  auto hovering = createFlight(path, 20, 400, 5.0);
+  CHECK(analyzeTrajectory({hovering}, path, banded).mDtwDistance >=
+        analyzeTrajectory({hovering}, path, full).mDtwDistance);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::userstudy
@@ -0,0 +1,215 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+#include "../src/TrajectoryCodec.hpp"
+
+#include <doctest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace csp::userstudy {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Creates a block with a random walk of the observer. Time, checkpoint index and scale change
+// irregularly so that all branches of the encoding are exercised.
+TrajectoryBlock createBlock(std::size_t sampleCount) {
+  std::mt19937                     generator(1);
+  std::normal_distribution<double> normal(0.0, 1.0);
+
+  TrajectoryBlock block;
+  block.mCenter = "Earth";
+  block.mFrame  = "IAU_Earth";
+
+  glm::dvec3 position(6.4e6, 1e5, 3e4);
+  glm::dquat rotation(1.0, 0.0, 0.0, 0.0);
+
+  for (std::size_t i = 0; i < sampleCount; ++i) {
+    glm::dvec3 step(normal(generator), normal(generator), normal(generator));
+    position = position + step * 10.0;
+    rotation = glm::normalize(glm::dquat(rotation.w + normal(generator) * 0.01,
+        rotation.x + normal(generator) * 0.01, rotation.y + normal(generator) * 0.01,
+        rotation.z + normal(generator) * 0.01));
+
+    TrajectorySample sample;
+    sample.mTime       = static_cast<int64_t>(i * 11111 + i % 3);
+    sample.mCheckpoint = static_cast<uint32_t>(i / 500);
+    sample.mPosition   = position;
+    sample.mRotation   = rotation;
+    sample.mScale      = i < sampleCount / 2 ? 1.0 : 2.5 + normal(generator);
+
+    block.mSamples.push_back(sample);
+  }
+
+  return block;
+}
+
+// Returns the angle between the two rotations in radians.
+double getAngle(glm::dquat const& a, glm::dquat const& b) {
+  return 2.0 * std::acos(std::min(1.0, std::abs(glm::dot(a, b))));
+}
+
+std::vector<TrajectorySample> roundTrip(
+    TrajectoryBlock const& block, TrajectoryQuantization const& quantization) {
+  std::string data;
+  encodeTrajectoryBlock(block, quantization, data);
+
+  auto decoded = decodeTrajectory(data);
+  REQUIRE(decoded.size() == 1);
+  REQUIRE(decoded[0].mSamples.size() == block.mSamples.size());
+  CHECK(decoded[0].mCenter == block.mCenter);
+  CHECK(decoded[0].mFrame == block.mFrame);
+
+  return decoded[0].mSamples;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::userstudy::encodeTrajectoryBlock - time and checkpoint are lossless") {
+  auto block = createBlock(5000);
+
+  for (auto const& quantization : {TrajectoryQuantization{}, TrajectoryQuantization{0.0, 0, 0}}) {
+    auto samples = roundTrip(block, quantization);
+
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+      CHECK(samples[i].mTime == block.mSamples[i].mTime);
+      CHECK(samples[i].mCheckpoint == block.mSamples[i].mCheckpoint);
+    }
+  }
+}
+
+TEST_CASE("csp::userstudy::encodeTrajectoryBlock - poses are lossless without quantization") {
+  auto block   = createBlock(5000);
+  auto samples = roundTrip(block, TrajectoryQuantization{0.0, 0, 0});
+
+  for (std::size_t i = 0; i < samples.size(); ++i) {
+    CHECK(samples[i].mPosition == block.mSamples[i].mPosition);
+    CHECK(samples[i].mRotation == block.mSamples[i].mRotation);
+    CHECK(samples[i].mScale == block.mSamples[i].mScale);
+  }
+}
+
+TEST_CASE("csp::userstudy::encodeTrajectoryBlock - quantization error is bounded") {
+  auto block = createBlock(5000);
+
+  for (uint32_t bits : {8U, 12U, 16U}) {
+    TrajectoryQuantization quantization;
+    quantization.mPositionPrecision = 0.01;
+    quantization.mRotationBits      = bits;
+    quantization.mScaleBits         = bits;
+
+    auto samples = roundTrip(block, quantization);
+
+    // Each position component is rounded to the nearest multiple of the precision. Each of the
+    // three stored rotation components has an error of at most half a quantization step. The
+    // reconstructed largest component adds at most twice this error, so the rotation angle
+    // differs by less than five times the component error.
+    double maxPositionError = 0.5 * std::sqrt(3.0) * quantization.mPositionPrecision;
+    double componentError   = 0.5 / (std::ldexp(1.0, static_cast<int>(bits) - 1) - 1.0);
+    double maxRotationError = 5.0 * componentError;
+    double positionError    = 0.0;
+    double rotationError    = 0.0;
+    double scaleError       = 0.0;
+
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+      auto const& original = block.mSamples[i];
+
+      positionError =
+          std::max(positionError, glm::length(samples[i].mPosition - original.mPosition));
+      rotationError = std::max(rotationError, getAngle(samples[i].mRotation, original.mRotation));
+      scaleError =
+          std::max(scaleError, std::abs(samples[i].mScale - original.mScale) / original.mScale);
+    }
+
+    CHECK(positionError <= maxPositionError);
+    CHECK(rotationError <= maxRotationError);
+
+    // The scale is stored as log2(scale) with the given number of fractional bits.
+    CHECK(scaleError <= std::ldexp(1.0, -static_cast<int>(quantization.mScaleBits) - 1));
+  }
+}
+
+TEST_CASE("csp::userstudy::encodeTrajectoryBlock - smooth flights are compressed") {
+  std::mt19937                     generator(2);
+  std::normal_distribution<double> normal(0.0, 1.0);
+
+  // A flight at 90 Hz with some frame-time jitter and slowly changing velocity and rotation.
+  TrajectoryBlock block;
+  glm::dvec3      position(6.4e6, 1e5, 3e4);
+  glm::dvec3      velocity(50.0, 0.0, 0.0);
+  double          time    = 0.0;
+  double          yaw     = 0.0;
+  double          yawRate = 0.01;
+
+  for (std::size_t i = 0; i < 10000; ++i) {
+    time += 11111.0 + normal(generator) * 200.0;
+    glm::dvec3 acceleration(normal(generator), normal(generator), normal(generator));
+    velocity = velocity + acceleration * 0.05;
+    position = position + velocity * (1.0 / 90.0);
+    yawRate += normal(generator) * 0.0005;
+    yaw += yawRate;
+
+    TrajectorySample sample;
+    sample.mTime       = static_cast<int64_t>(time);
+    sample.mCheckpoint = static_cast<uint32_t>(i / 900);
+    sample.mPosition   = position;
+    sample.mRotation   = glm::dquat(std::cos(yaw / 2.0), 0.0, 0.0, std::sin(yaw / 2.0));
+    sample.mScale      = 1000.0;
+    block.mSamples.push_back(sample);
+  }
+
+  std::string data;
+  encodeTrajectoryBlock(block, {}, data);
+
+  // A raw sample requires 76 bytes.
+  CHECK(data.size() < 9 * block.mSamples.size());
+}
+
+TEST_CASE("csp::userstudy::decodeTrajectory - truncated last block is skipped") {
+  auto block = createBlock(1000);
+
+  std::string data;
+  encodeTrajectoryBlock(block, {}, data);
+  encodeTrajectoryBlock(block, {}, data);
+
+  auto decoded = decodeTrajectory(std::string_view(data).substr(0, data.size() - 5));
+  REQUIRE(decoded.size() == 1);
+  CHECK(decoded[0].mSamples.size() == block.mSamples.size());
+}
+
+TEST_CASE("csp::userstudy::TrajectoryWriter - starts a new block when the frame changes") {
+  auto        block    = createBlock(1000);
+  std::string fileName = "csp-user-study-trajectory-test.bin";
+
+  {
+    TrajectoryWriter writer(fileName, {}, 300);
+    for (std::size_t i = 0; i < block.mSamples.size(); ++i) {
+      writer.push(i < 500 ? "Earth" : "Moon", "IAU_Earth", block.mSamples[i]);
+    }
+  }
+
+  auto blocks = readTrajectory(fileName);
+  std::remove(fileName.c_str());
+
+  // The samples are split into blocks of 300, 200 (frame change), 300 and 200.
+  REQUIRE(blocks.size() == 4);
+  CHECK(blocks[1].mCenter == "Earth");
+  CHECK(blocks[2].mCenter == "Moon");
+  CHECK(blocks[0].mSamples.size() + blocks[1].mSamples.size() == 500);
+  CHECK(blocks[2].mSamples.size() + blocks[3].mSamples.size() == 500);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::userstudy
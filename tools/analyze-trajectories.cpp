@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SPDX-FileCopyrightText: German Aerospace Center (DLR) <cosmoscout@dlr.de>
+// SPDX-License-Identifier: MIT
+
+// This tool compares recorded trajectories of participants to the checkpoints of a scenario. The
+// results are written as CSV to stdout, one line per trajectory file.
+//
+// Usage: csp-user-study-analyze [options] <scenario.json> <trajectory.bin>...
+//   --threads <n>        Number of worker threads. Defaults to the number of hardware threads.
+//   --lateral-window <n> Segments around the current checkpoint searched for the lateral deviation.
+//                        Zero searches all segments (16).
+//   --band <f>           Half width of the DTW band relative to the reference length (0.1).
+//   --dtw-points <n>     Number of points the reference path is resampled to for DTW (1024).
+//   --turn-angle <deg>   Minimum change of direction at a turn in degrees (30).
+
+#include "../src/TrajectoryAnalysis.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+void printUsage() {
+  std::cerr << "Usage: csp-user-study-analyze [options] <scenario.json> <trajectory.bin>...\n"
+               "  --threads <n>        Number of worker threads (default: hardware threads).\n"
+               "  --lateral-window <n> Segments around the current checkpoint searched for the "
+               "lateral deviation, 0 for all (default: 16).\n"
+               "  --band <f>           Half width of the DTW band relative to the reference "
+               "length (default: 0.1).\n"
+               "  --dtw-points <n>     Number of points the reference path is resampled to for "
+               "DTW (default: 1024).\n"
+               "  --turn-angle <deg>   Minimum change of direction at a turn (default: 30).\n";
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+  csp::userstudy::PathDeviationOptions options;
+  std::size_t                          threadCount = 0;
+  std::vector<std::string>             positional;
+
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+
+      if (arg == "-h" || arg == "--help") {
+        printUsage();
+        return 0;
+      }
+
+      bool hasValue = arg == "--threads" || arg == "--lateral-window" || arg == "--band" ||
+                      arg == "--dtw-points" || arg == "--turn-angle";
+
+      if (hasValue && i + 1 < argc) {
+        std::string value = argv[++i];
+
+        if (arg == "--threads") {
+          threadCount = std::stoul(value);
+        } else if (arg == "--lateral-window") {
+          options.mLateralSearchWindow = std::stoul(value);
+        } else if (arg == "--band") {
+          options.mDtwBand = std::stod(value);
+        } else if (arg == "--dtw-points") {
+          options.mDtwReferencePoints = std::stoul(value);
+        } else {
+          options.mTurnAngle = std::stod(value);
+        }
+      } else if (arg.rfind("--", 0) == 0) {
+        std::cerr << "Unknown option \"" << arg << "\"!" << std::endl;
+        printUsage();
+        return 1;
+      } else {
+        positional.push_back(arg);
+      }
+    }
+  } catch (std::exception const&) {
+    std::cerr << "Invalid option value!" << std::endl;
+    printUsage();
+    return 1;
+  }
+
+  if (positional.size() < 2) {
+    printUsage();
+    return 1;
+  }
+
+  csp::userstudy::ReferencePath reference;
+
+  try {
+    reference = csp::userstudy::loadReferencePath(positional[0]);
+  } catch (std::exception const& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  if (reference.mPoints.empty()) {
+    std::cerr << "The scenario \"" << positional[0] << "\" has no checkpoints with a position!"
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string> files(positional.begin() + 1, positional.end());
+  auto results = csp::userstudy::analyzeTrajectoryFiles(files, reference, options, threadCount);
+
+  std::cout << "file,samples,meanLateralDeviation,rmsLateralDeviation,maxLateralDeviation,"
+               "dtwDistance,meanDtwDistance,turns,meanOvershoot,maxOvershoot"
+            << std::endl;
+
+  int status = 0;
+
+  for (auto const& result : results) {
+    if (!result.mDeviation) {
+      std::cerr << result.mFile << ": " << result.mError << std::endl;
+      status = 1;
+      continue;
+    }
+
+    auto const& d = *result.mDeviation;
+    std::cout << result.mFile << "," << d.mSampleCount << "," << d.mMeanLateralDeviation << ","
+              << d.mRmsLateralDeviation << "," << d.mMaxLateralDeviation << "," << d.mDtwDistance
+              << "," << d.mMeanDtwDistance << "," << d.mTurnCount << "," << d.mMeanOvershoot << ","
+              << d.mMaxOvershoot << std::endl;
+  }
+
+  return status;
+}